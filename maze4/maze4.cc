@@ -2,11 +2,14 @@
 #define NCURSES_WIDECHAR 1
 #define _GNU_SOURCE 1
 
+#include <langinfo.h>
 #include <locale.h>
 #include <math.h>
 #include <ncurses.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,59 +17,63 @@
 #include <time.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <queue>
 #include <random>
+#include <thread>
+#include <vector>
 
 // DEFINES ///////////////////////////////////////////////////////////////////
 
 // macros
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
 
 // UTF-8 characters for maze elements
-#define CURRENT_CHAR1 "①"
-#define CURRENT_CHAR2 "②"
-#define CURRENT_CHAR3 "③"
-#define CURRENT_CHAR4 "④"
-#define VISITED_CHAR1 "◇" // RED
-#define VISITED_CHAR2 "◇" // CYAN
-#define VISITED_CHAR3 "◇" // YELLOW
-#define VISITED_CHAR4 "◇" // GREEN
-#define SOLUTION_CHAR1 "◆"
-#define SOLUTION_CHAR2 "◆"
-#define SOLUTION_CHAR3 "◆"
-#define SOLUTION_CHAR4 "◆"
-#define END_CHAR1 "R" // raspberry
-#define END_CHAR2 "B" // blueberry
-#define END_CHAR3 "L" // lemon
-#define END_CHAR4 "K" // kiwi
+// (bot position and goal glyphs are generated per bot, see make_bot_glyphs)
+#define VISITED_CHAR "◇"
+#define SOLUTION_CHAR "◆"
 #define TELEPORTER_CHAR "◎"
 #define MONSTER_CHAR "☠"
 #define DEFEATED_MONSTER_CHAR "†"
 #define WALL_CHAR "▒"
 #define PATH_CHAR " "
+#define SWARM_CHAR "●"
 
 // Internal representations
-#define CURRENT1  'a'
-#define CURRENT2  'b'
-#define CURRENT3  'c'
-#define CURRENT4  'd'
-#define VISITED1  'e'
-#define VISITED2  'f'
-#define VISITED3  'g'
-#define VISITED4  'h'
-#define SOLUTION1 'i'
-#define SOLUTION2 'j'
-#define SOLUTION3 'k'
-#define SOLUTION4 'l'
-#define END1 '1'
-#define END2 '2'
-#define END3 '3'
-#define END4 '4'
 #define TELEPORTER 'T'
 #define MONSTER 'M'
 #define DEFEATED_MONSTER 'N'
 #define WALL '#'
 #define PATH ' '
+// Per-bot cells are a kind base plus the 0-based bot index
+#define CURRENT_BASE  0x100
+#define VISITED_BASE  0x200
+#define SOLUTION_BASE 0x300
+#define END_BASE      0x400
+#define CELL_CODES    0x500
+#define CELL_STALE    0xFFFF // shadow cell that must be redrawn
+#define CELL_KIND(c)   ((c) & 0xF00)
+#define CELL_PLAYER(c) ((c) & 0x0FF)
+
+// Per-bot trail values kept in maze->visited[p]
+#define TRAIL_NONE     0 // not visited yet
+#define TRAIL_ROOT     1 // visited, no parent (start cell)
+#define TRAIL_DIR      2 // 2..5: visited, parent is in direction Base_dx/dy
+#define TRAIL_TELEPORT 6 // visited, parent is the partner teleporter
+#define TRAIL_BITS     0x07 // the trail value; the bits above hold the
+#define MARK_SHIFT     3    // marks of the wall and Trémaux strategies
 
 // mins, maxes, etc.
 #define MIN_ROWS 25
@@ -75,21 +82,95 @@
 #define MAX_COLS 1024
 #define DEF_GAME_SPEED 50
 #define MAX_GAME_DELAY 200
+#define MAX_TICK_RATE 100000      // --tps
+#define MAX_FRAME_RATE 240        // --fps
+#define DEF_FRAME_RATE 60         // --fps when only --tps is given
+#define TICK_SLACK_NS 250000000LL // --tps: further behind than this, don't catch up
+#define OUTPUT_TARGET_MS 100      // how far behind the game a slow terminal may fall
+#define ADAPT_WINDOW_MS 500       // frame output measured over this long at a time
+#define ADAPT_CALM_WINDOWS 4      // idle windows before a slow terminal gets more
+#define MIN_ADAPT_FPS 2           // the lowest frame rate it is slowed to
+#define MIN_FRAME_CELLS 64        // the fewest cells a frame draws on it
+#define SKIP_DRAW_MS 50           // wait for the terminal before skipping an effect
+#define ANSI_CELL_BYTES 64        // most one cell takes with --ansi: move, SGR, glyph
+#define ANSI_GAP_MAX 8            // widest unchanged gap --ansi rewrites to skip it
 #define DEF_TELEPORTER_DENSITY 1000
 #define MAX_TELEPORTERS 10
 #define DEF_MONSTER_DENSITY 500
-#define MAX_MONSTERS 26
+#define DEF_MAX_MONSTERS 26 // cap for the auto-calculated count
+#define MAX_MONSTERS 65536
 #define DEF_MONSTER_STRENGTH 10
 #define MAX_MONSTER_STRENGTH 15
 #define DEF_PLAYER_STRENGTH   6
+#define TICK_TIME 12              // game time of one tick (a normal bot move)
+#define BOT_PERIOD TICK_TIME      // default time between bot moves
+#define MONSTER_PERIOD (5 * TICK_TIME) // default time between monster moves
+#define MAX_SPEED_SPREAD 90
+#define WIN_SAMPLES 4000          // model races per win estimate
+#define WIN_REFRESH_TICKS 8       // ticks between win estimates
+#define WIN_SPREAD 16.0           // moves per dead end backed out of
+#define PURSUIT_RADIUS 64         // moves within which monsters sense bots
+#define LEAP_BLOCK 16             // side of the blocks bots' frontiers
+                                  // are counted in, for corridor leaps
+#define FLOW_NONE 0xFF            // Flow_dist of a cell with no bot near
+
+// Outcome kinds of a bot's move (see Outcome)
+#define OUTCOME_NONE       0 // no move resolved yet
+#define OUTCOME_SETTLED    1 // moved onto the cell
+#define OUTCOME_RETREATED  2 // lost a bot battle, back where it came from
+#define OUTCOME_TELEPORTED 3 // on a teleporter, cell is the far end
+#define OUTCOME_BLOCKED    4 // lost to a monster on the cell
+
+// Bot strategies (see start_controller)
+#define STRAT_DFS      0
+#define STRAT_WALL     1
+#define STRAT_TREMAUX  2
+#define STRAT_GREEDY   3
+#define STRAT_ASTAR    4
+#define STRAT_ORACLE   5
+#define NUM_STRATEGIES 6
 #define MAX_ATTEMPTS 100 // Maximum attempts for placing teleporters/monsters
 #define POLL_INTERVAL_MS 333
-#define NUM_PLAYERS 4
+#define DEF_PLAYERS 4
+#define MAX_PLAYERS 256 // must fit in CELL_PLAYER()
+#define STATS_ROWS 4    // bot rows in the stats panel
+#define DEF_MAX_THREADS 8      // cap for the auto-detected thread count
+#define MAX_THREADS 64
+#define PARALLEL_MIN_ITEMS 32  // fewer bots than this propose inline
+#define NUM_MONSTER_NAMES 26
 #define MAX_HIGH_SCORES 10
 #define HIGH_SCORE_FILENAME "maze4_high_scores.dat"
 #define LOG_FILENAME "maze4_logfile.txt"
 #define STATUS_LINE_HISTORY 20
 #define STATUS_LINE_MAX 80
+#define DEF_HEADLESS_ROWS 61  // maze size without a terminal
+#define RENDER_BENCH_ROWS 60  // terminal drawn to by --bench-render
+#define RENDER_BENCH_COLS 200
+#define RENDER_BENCH_FRAMES 200
+#define RENDER_BENCH_STEP 40  // cells changed per frame in the step frames
+#define DEF_HEADLESS_COLS 201
+#define DEF_BENCH_ROUNDS 5
+#define DEF_REWIND_MB 64      // rewind log budget when playing
+#define MAX_REWIND_MB 4096
+
+// Recording (--record/--replay) event kinds: the low 3 bits of an event's
+// first varint, the bot, monster or battle type above them
+#define RECORD_MAGIC "MZ4R"
+#define RECORD_VERSION 4
+#define RECORD_END "MZ4E" // trailer: the events' length (8 bytes, little
+                          // endian), then this, written when the game ends
+#define EV_STEP    0 // 0-3: a bot stepped in direction 0-3
+#define EV_JUMP    4 // a bot teleported, leapt or retreated; then x and y
+#define EV_BATTLE  5 // type * 2 + left won; then left and right
+#define EV_MONSTER 6 // (monsters skipped since the last one this tick) * 5
+                     // + direction patrolled (4: blocked)
+#define EV_CONTROL 7 // 0: round over, 1: round cut short, 2 + n: n time
+                     // units on to the next event
+
+// Snapshots (s key, SIGUSR1, SIGTERM/SIGHUP) for --resume
+#define SNAPSHOT_FILENAME "maze4_snapshot.dat"
+#define SNAPSHOT_MAGIC "MZ4S"
+#define SNAPSHOT_VERSION 2
 
 // messages
 #define DELAY_MSG "** Delaying for you to read **"
@@ -98,13 +179,23 @@
 
 // TYPEDEFS //////////////////////////////////////////////////////////////////
 
+typedef unsigned short Cell; // grid cell code, see CELL_KIND()
+
 typedef struct {
   int x, y;
 } Coord;
 
+// One bit per cell, 64 cells to a word: bit x & 63 of word x / 64 of row
+// y, for the bit-parallel flood fill
+typedef struct {
+  int rows, cols;
+  int words; // per row
+  std::vector<uint64_t> bits;
+} BitPlane;
+
 typedef struct {
   char name[32];   // Player name
-  int player_id;   // Player ID (1-4)
+  int player_id;   // Player ID (1-MAX_PLAYERS)
   int score;       // calculate_score() value
   int battles_won; // Number of battles won
   int strength;    // Final strength
@@ -115,9 +206,14 @@ typedef struct {
 typedef struct {
   int rows;
   int cols;
-  char **grid;
-  // Separate visited grids for each player
-  char **visited[NUM_PLAYERS];
+  Cell **grid;
+  // Separate visited (trail) grids for each player
+  char ***visited;
+  // Occupancy lists: index+1 of the first bot/monster in a cell, 0 if none
+  int **bot_at;
+  int **monster_at;
+  // Junction graph node index of each cell, -1 for corridors and walls
+  int **node_at;
 } Maze;
 
 typedef struct {
@@ -127,47 +223,326 @@ typedef struct {
   int parentY;
 } Position;
 
+// Cells a corridor leap stands for, until the bot would have walked them
+typedef struct {
+  int x0, y0, x1, y1; // bounding box of the corridor
+  int until;          // Game_time the leap ends
+} LeapSpan;
+
 typedef struct {
   int x1, y1; // First teleporter location
   int x2, y2; // Second teleporter location
 } Teleporter;
 
 typedef struct {
-  int x, y;           // Current position
-  int dx, dy;         // Direction of movement
-  int patrol_length;  // How far it patrols
-  int steps;          // Current step count
-  int strength;       // Monster strength (1-10)
-  int defeated;       // Whether the monster has been defeated
-  int recovery_turns; // lick wounds time to prevent battle loops
-} Monster;
+  int x, y;          // Where it starts
+  int dir;           // Initial direction (index into Base_dx/Base_dy)
+  int patrol_length; // How far it patrols
+  int strength;      // Monster strength (1-10)
+} MonsterSpawn;
+
+// A round's maze with its goals, teleporters and monster spawns, built from
+// its own seed so the next one can be made on a worker thread while the
+// current round is played
+typedef struct {
+  int term_rows, term_cols;  // terminal size it was made for
+  int num_teleporters;       // requested counts
+  int num_monsters;
+  int max_strength;
+  uint64_t seed;             // generator state for layout_rand()
+  Maze *maze;                // NULL until built (or if allocation failed)
+  Teleporter teleporters[MAX_TELEPORTERS];
+  int placed_teleporters;
+  std::vector<MonsterSpawn> monsters;
+} Layout;
+
+// Monsters are stored as one array per field (structure of arrays) so each
+// pass only streams the fields it needs
+typedef struct {
+  char name[16];      // Display name
+} MonsterInfo;
 
 typedef struct {
-  int id;             // Player ID (1-4)
+  std::vector<int> x, y;           // Current position
+  std::vector<int> dx, dy;         // Direction of movement
+  std::vector<int> patrol_length;  // How far it patrols
+  std::vector<int> steps;          // Current step count
+  std::vector<int> strength;       // Monster strength (1-10)
+  std::vector<int> defeated;       // Whether the monster has been defeated
+  std::vector<int> recovery_until; // no battles before this time (licks wounds)
+  std::vector<int> period;         // time between moves (see TICK_TIME)
+  std::vector<int> next_at;        // next monster in the same cell (index+1)
+  std::vector<Cell> under;         // cell code under a pursuing monster
+  std::vector<MonsterInfo> info;   // cold: only used for display
+} MonsterStore;
+
+// Per-bot data that is fixed for the round and only read for display or
+// when a bot expands its search
+typedef struct {
+  int id;             // Player ID (1-MAX_PLAYERS)
   Position start;     // Starting position
   Position end;       // Target position
-  Position current;   // Current position
-  int strength;       // Player's strength (increases with battles won)
-  int battles_won;    // Number of battles won
-  int battles_lost;   // Number of battles lost
-  int recovery_turns; // lick wounds time to prevent battle loops
-  int justTeleported; // prevent loops
-  int moves;          // Number of moves made
-  int reached_goal;   // Whether player has reached goal
-  int finished_rank;  // Finishing rank (1st, 2nd, etc)
-  int abandoned_race; // Whether player has abandoned the race
-  char visited_char;  // Character to represent visited cells
-  char solution_char; // Character to represent solution path
+  Cell visited_char;  // Character to represent visited cells
+  Cell solution_char; // Character to represent solution path
   int color_pair;     // Color pair for this player
   int dx[4];          // Player-specific direction arrays
   int dy[4];          // Direction preferences for exploration
-} Player;
+  int strategy;       // STRAT_* controller
+  char name[8];           // Short name (stats panel, high scores)
+  char long_name[16];     // Long name (wide stats panel, battle windows)
+  char current_glyph[8];  // UTF-8 glyph for the bot itself
+  char end_glyph[8];      // UTF-8 glyph for the bot's goal
+} PlayerInfo;
+
+// Bots are stored as one array per field (structure of arrays): the fields
+// touched every tick are kept apart from the battle stats and cold info
+typedef struct {
+  // hot: read or written every tick
+  std::vector<Position> current;   // Current position
+  std::vector<int> recovery_until; // no battles before this time (licks wounds)
+  std::vector<int> teleport_until; // no teleporting before this time (loops)
+  std::vector<int> period;         // time between moves (see TICK_TIME)
+  std::vector<int> reached_goal;   // Whether player has reached goal
+  std::vector<int> abandoned_race; // Whether player has abandoned the race
+  std::vector<int> moves;          // Number of moves made
+  std::vector<int> expanded;       // Cells the controller expanded
+  std::vector<int> optimal;        // fewest moves from start to goal
+  std::vector<int> next_at;        // next bot in the same cell (index+1)
+  // warm: battles and finishing
+  std::vector<int> strength;       // Player's strength (increases with wins)
+  std::vector<int> battles_won;    // Number of battles won
+  std::vector<int> battles_lost;   // Number of battles lost
+  std::vector<int> finished_rank;  // Finishing rank (1st, 2nd, etc)
+  // cold
+  std::vector<PlayerInfo> info;
+} PlayerStore;
+
+// Junction graph of the round (see build_junction_graph), edges are kept
+// per node and direction: index node * 4 + dir
+typedef struct {
+  int num_nodes;
+  int num_edges;
+  int open_cells;
+  std::vector<int> x, y;   // node cells
+  std::vector<int> to;     // far node of the corridor, -1 if no exit
+  std::vector<int> length; // corridor length in cells, far node included
+  std::vector<int> jump;   // node at the far end of a teleporter, or -1
+  // Each corridor once: its end nodes and its cells (y << 16 | x) in order
+  // from end a, corridor c's cells are cells[corridor_first[c]] up to
+  // cells[corridor_first[c + 1]]
+  std::vector<int> corridor_a, corridor_b, corridor_first;
+  std::vector<unsigned> cells;
+  // Per cell (y * cols + x): its corridor and how many cells it is from
+  // end a, -1 for nodes and walls
+  std::vector<int> cell_corridor, cell_step;
+  int max_length;          // the longest corridor
+} JunctionGraph;
+
+// What became of a bot's last proposed move, set by the resolve phase and
+// read by the bot's controller when it is next resumed
+typedef struct {
+  int kind;      // OUTCOME_*
+  Position cell; // cell moved onto, or the far end of a teleporter
+} Outcome;
+
+// One battle as resolve_battle() played it, for present_battle(). Side 0
+// is the left combatant, side 1 the right
+typedef struct {
+  int type;        // 0 = bot vs monster, 1 = bot vs bot, 2 = monster vs monster
+  int left, right; // bot or monster index of each side
+  int is_bot[2];
+  int fought;      // 0 if a side was still recovering
+  int left_wins;
+  int roll[2];
+  int strength[2]; // going in, the winner's has gone up since
+  int wins[2];     // bot battles won going in
+  int x, y;        // where it happened
+} BattleOutcome;
+
+// What the board and the stats panel show of a bot, kept for rewinding
+typedef struct {
+  int x, y;
+  int strength;
+  int battles_won, battles_lost;
+  int moves;
+  int reached_goal, finished_rank, abandoned_race;
+} BotView;
+
+typedef struct {
+  uint32_t index; // y * cols + x
+  Cell value;     // what the cell became
+} CellChange;
+
+typedef struct {
+  int p;
+  BotView view;
+} BotChange;
+
+// One recorded tick: where its changes end in the segment's lists
+typedef struct {
+  int tick;         // Game_moves
+  int liv_monsters;
+  uint32_t cells;
+  uint32_t bots;
+} TickMark;
+
+// Rewind log segment: a checkpoint of the board and bots, then the changes
+// of each tick recorded since. The oldest segments are dropped to keep the
+// log within Rewind_mb
+typedef struct {
+  int first_step;               // recorded ticks before the checkpoint
+  TickMark start;               // tick and monsters at the checkpoint
+  std::vector<Cell> grid;
+  std::vector<BotView> bots;
+  std::vector<CellChange> cells;
+  std::vector<BotChange> bot_changes;
+  std::vector<TickMark> ticks;
+} RewindSegment;
+
+// What a round was made from: its random seed, its layout and the settings
+// the layout was built for. Enough to play the round again (see
+// save_snapshot)
+typedef struct {
+  unsigned rand_seed;       // srand() at the start of the round
+  uint64_t layout_seed;
+  int term_rows, term_cols;
+  int num_teleporters;      // requested counts
+  int num_monsters;
+  int max_strength;
+} RoundStart;
+
+typedef struct {
+  int x, y;
+  int strength;
+  int defeated;
+} SnapshotMonster;
+
+// Snapshot image: this header, then the board (rows * cols Cells), a
+// BotView per bot, a SnapshotMonster per monster, the teleporters, the
+// status history and the strategy list
+typedef struct {
+  char magic[4];         // SNAPSHOT_MAGIC
+  uint32_t version;      // SNAPSHOT_VERSION
+  uint64_t bytes;        // the whole image
+  // options that shape the game
+  unsigned seed;
+  int num_players;
+  int speed_spread;
+  int use_corridors;
+  int pursuit;
+  int num_strategies;
+  int maze_rows, maze_cols; // --rows/--cols
+  // the session
+  int rounds_left;       // Game_rounds, this one included
+  int rounds_total;      // Game_roundsB
+  int round;             // Rounds_started
+  RoundStart start;
+  // the round as it stands
+  int game_time;
+  int liv_monsters;
+  int players_finished;
+  int rows, cols;
+  int num_monsters;
+  int num_teleporters;
+} SnapshotHeader;
+
+// One frame of the board (maze, info line and stats panel), composed from
+// the game state so the render thread can draw it while the game plays on
+typedef struct {
+  int generation;             // Frame_generation when composed
+  int rows, cols;             // maze cells shown
+  std::vector<Cell> cells;    // rows x cols
+  char info[128];             // game info, drawn over the top row
+  int info_len;
+  int stats_row;              // stats panel header row, -1 if none
+  char header[80];
+  int num_lines;              // stats rows after the header
+  char lines[STATS_ROWS + 1][160];
+  attr_t line_attrs[STATS_ROWS + 1];
+} BoardFrame;
+
+// How --ansi draws a cell: colours as ncurses colour numbers (-1 for the
+// terminal's default) and bold
+typedef struct {
+  short fg, bg;
+  short bold;
+} AnsiStyle;
+
+typedef struct {
+  char text[8];               // UTF-8
+  int len;
+  AnsiStyle style;
+} AnsiGlyph;
+
+// What the win estimator knows of a bot (see post_win_estimate)
+typedef struct {
+  int racing;          // still solving
+  int finished_rank;   // 0 if not finished
+  int left;            // moves to its goal from where it stands
+  int period;          // time between moves
+  int lives;           // battles it can still lose
+  double efficiency;   // progress to the goal per move so far
+  double battle_rate;  // battles per move so far
+  double lose_chance;  // of a battle with an average live monster
+} WinBot;
+
+// Scheduled action: who (bot index, or -1 - monster index) acts at time
+typedef struct {
+  int time;
+  int who;
+} Event;
+
+// Orders the event queue earliest first, bots before monsters on ties
+struct EventLater {
+  bool operator()(const Event &a, const Event &b) const {
+    return a.time != b.time ? a.time > b.time : a.who < b.who;
+  }
+};
 
 typedef struct Node {
   Position pos;
   struct Node *next;
 } Node;
 
+// A bot controller is a coroutine that yields the bot's next cell each time
+// the scheduler resumes it and returns when the bot has nowhere left to go.
+// It starts suspended; the owning task destroys the frame
+struct BotTask {
+  struct promise_type {
+    Position move;
+
+    BotTask get_return_object() {
+      return BotTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(Position pos) noexcept {
+      move = pos;
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { abort(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+
+  BotTask() : handle(NULL) {}
+  explicit BotTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+  BotTask(BotTask &&other) noexcept : handle(other.handle) {
+    other.handle = NULL;
+  }
+  BotTask &operator=(BotTask &&other) noexcept {
+    std::swap(handle, other.handle);
+    return *this;
+  }
+  BotTask(const BotTask &) = delete;
+  BotTask &operator=(const BotTask &) = delete;
+  ~BotTask() {
+    if (handle)
+      handle.destroy();
+  }
+};
+
 typedef struct Status {
   int move;
   char msg[STATUS_LINE_MAX];
@@ -192,7 +567,27 @@ const char *BOT_NAMES_LONG[] = {
     "Kwick Kiwi     "
 };
 
-char *BOT_NAMES_F[5] = {};
+// Name parts for generated bots (ids 5 and up); 3-letter prefixes are unique
+const char *BOT_ADJECTIVES[] = {
+    "Agile",  "Brave",  "Cosmic", "Daring", "Epic",   "Fierce",
+    "Groovy", "Hyper",  "Jazzy",  "Mighty", "Nimble", "Plucky",
+    "Sonic",  "Turbo",  "Wild",   "Zippy"
+};
+
+const char *BOT_FRUITS[] = {
+    "Apricot", "Banana", "Cherry", "Date",   "Fig",    "Grape",
+    "Guava",   "Lime",   "Mango",  "Melon",  "Orange", "Papaya",
+    "Peach",   "Plum",   "Quince", "Satsuma"
+};
+
+// Strategy names for --strategy and the reports, indexed by STRAT_*
+const char *STRATEGY_NAMES[NUM_STRATEGIES] = {
+    "dfs", "wall", "tremaux", "greedy", "astar", "oracle"
+};
+std::vector<int> Strategies; // --strategy list, cycled through the bots
+
+// Colour pairs cycled through by the bots
+const int BOT_COLOR_PAIRS[] = {2, 3, 4, 5, 17, 18, 19};
 
 const char *MONSTER_NAMES[] = {
     "Abyssal Articho", "Brutal Broccoli", "Creeping Carrot",
@@ -206,31 +601,90 @@ const char *MONSTER_NAMES[] = {
     "Yucky Yam      ", "Zealous Zuke   "
 };
     
-char *MONSTER_NAMES_R[26] = {};
+char *MONSTER_NAMES_R[NUM_MONSTER_NAMES] = {};
 
 // Misc globals
 WINDOW *battle_win;
+WINDOW *Input_win;     // read_keyboard() reads here, so reading never draws
 int Base_dx[] = {0, 1, 0, -1}; // Up, Right, Down, Left
 int Base_dy[] = {-1, 0, 1, 0};
 
 // Global arrays for teleporters and monsters
 Teleporter teleporters[MAX_TELEPORTERS];
 int Num_teleporters = -1;
-Monster monsters[MAX_MONSTERS];
+MonsterStore monsters;
 int Num_monsters = -1;
 int Liv_monsters = 0;
 int Max_monster_strength = -1;
 
 // Array of players
-Player players[NUM_PLAYERS];
-Coord  parent_map[NUM_PLAYERS][MAX_ROWS][MAX_COLS];
+PlayerStore players;
+int Num_players = -1;
+int Long_names = 0;
+
+// Two-phase tick state (see solve_maze_multi), one entry per bot
+std::vector<Node *> Bot_stacks;   // DFS stack, only touched by its own bot
+std::vector<Position> Bot_move;   // cell proposed this tick, x == -1 if none
+std::vector<Outcome> Bot_outcome; // what became of each bot's last move
+std::vector<int> Bot_length;      // cells the proposed move covers (leaps)
+std::vector<LeapSpan> Bot_leap;   // corridor of each bot's last leap
+std::vector<uint16_t> Frontier;   // with --corridors, per best-first bot
+                                  // the queued cells in each LEAP_BLOCK
+int Block_cols = 0;               // blocks to a row of the maze
+int Num_blocks = 0;
+std::vector<uint8_t> Block_teleporters; // teleporter ends in each block
+int Min_bot_period = 1;           // the fastest bot's period
+std::vector<int> Tick_order;      // resolve order for this tick
+std::vector<int> Tick_rank;       // inverse of Tick_order
+std::vector<int> Cell_bots;       // scratch list for resolve_collisions()
+std::vector<int> Bot_due;         // bot acts at Game_time
+std::vector<int> Due_bots;        // bots acting at Game_time
+std::vector<int> Monster_due;     // monster acts at Game_time
+std::vector<int> Due_monsters;    // monsters acting at Game_time, in order
+std::vector<BotTask> Bot_tasks;   // controller coroutine of each bot
+int Use_coroutines = 1;           // 0: step the DFS inline (bench baseline)
+int Use_corridors = 0;            // DFS bots leap whole corridors (headless)
+int Monster_pursuit = 0;          // monsters chase the nearest bot (--pursuit)
+std::vector<uint8_t> Flow_dist;   // moves from each cell to the nearest
+                                  // racing bot, FLOW_NONE if none near
+std::vector<unsigned> Flow_queue; // cells (y << 16 | x) of the last field,
+                                  // in BFS order
+int Flow_time = -1;               // Game_time of the last field
+long long Steps_played = 0;       // bot moves resolved in the last solve
+JunctionGraph Junctions;          // the round's junctions and corridors
+std::vector<int> Node_dist;       // per bot, moves from each junction
+                                  // graph node to its goal, -1 if none
+
+// Propose-phase worker pool
+int Num_threads = -1;
+std::vector<std::thread> Pool_threads;
+std::mutex Pool_lock;
+std::condition_variable Pool_wake, Pool_done;
+void (*Pool_job)(int) = NULL;
+int Pool_items = 0;
+int Pool_busy = 0;
+unsigned Pool_generation = 0;
+int Pool_quit = 0;
 
 // Game state
 int Players_finished = 0;
+int Bot_retreats = 0;   // bot battles lost this round, the loser falling back
 int Game_finished = 0;
-int Game_moves = 0;
+int Game_moves = 0;     // ticks played (Game_time / TICK_TIME)
+int Game_time = 0;      // time of the events being played
+int Speed_spread = 0;   // +/- percent applied to each entity's period
 int Game_speed = -1;
 int Game_delay = 0;
+int Tick_rate = 0;      // --tps: ticks per second, 0: paced by Game_delay
+int Frame_rate = -1;    // --fps: frames per second, 0: draw every tick
+long long Tick_due_ns = 0;  // when the tick being played should end
+long long Frame_due_ns = 0; // when the next frame should be drawn
+// What a slow terminal can keep up with (see adapt_pacing), and what the
+// status line last said of it. While capped, effects are skipped and the
+// stats panel is drawn once a second
+std::atomic<int> Frame_cap{0};    // frames per second, 0: no cap
+std::atomic<int> Frame_cells{0};  // maze cells drawn a frame, 0: all changed
+int Adapt_shown = 0;
 int Game_rounds = -1;
 int Game_roundsB = -1;
 int ShowWindows = -1;
@@ -238,6 +692,7 @@ int WaitForKey  = -1;
 int LastSLupdate = 0;
 int current_status_index = 0;
 int Screen_reduced = 0;
+int Fast_forward = 0;   // play out the round without drawing (f key)
 Status status_lines[STATUS_LINE_HISTORY];
 int old_rows = 0; 
 int old_cols = 0;
@@ -247,80 +702,517 @@ int in_pausegame = 0;
 int pauseTime = -1;
 char Stats_header[80];
 
+// What print_maze last drew on stdscr, row by row, so a frame only redraws
+// the cells that changed. Anything else that draws over the maze calls
+// invalidate_shadow() or invalidate_rows(), which only note the rows for
+// the next frame drawn (see take_stale_rows), so they never wait for the
+// terminal
+std::vector<Cell> Shadow;
+int Shadow_rows = 0;
+int Shadow_cols = 0;
+int Info_len = 0;       // game info text drawn over the top row
+int Stale_from = INT_MAX, Stale_to = -1; // rows to draw again, guarded by
+                                         // Frame_lock
+
+// stdscr's size, noted under Curses_lock whenever it is resized, for
+// place_view() on the game thread
+int Term_rows = 0, Term_cols = 0;
+
+// The part of the maze on screen, placed for each frame by place_view():
+// its top left cell and size, the bot it follows (-1: whichever leads) and
+// whether the pan keys have moved it off that bot
+int View_y = 0, View_x = 0;
+int View_rows = 0, View_cols = 0;
+int View_follow = -1;
+int View_panned = 0;
+
+// Every cell code as drawn (glyph, colour pair and attributes), rebuilt for
+// each round's bots by build_glyphs()
+std::vector<cchar_t> Glyphs;
+std::vector<cchar_t> Glyph_run;    // a run of changed cells for print_maze
+int Use_glyph_table = 1;           // 0: draw each cell's UTF-8 text (bench baseline)
+
+// --ansi: the maze, info line and stats panel are written as ANSI escape
+// sequences into Ansi_out and sent with one write() per frame, bypassing
+// ncurses. ncurses still draws the status line, windows and effects
+int Use_ansi = 0;
+int Ansi_truecolor = -1;           // -1: when $COLORTERM says the terminal can
+int Ansi_rep = 0;                  // the terminal repeats a glyph (REP)
+int Ansi_fd = STDOUT_FILENO;
+std::vector<AnsiGlyph> Ansi_glyphs; // every cell code, built with Glyphs
+std::vector<char> Ansi_out;        // sized for a whole frame of changes
+size_t Ansi_len = 0;               // bytes of the frame so far
+int Ansi_row = -1, Ansi_col = -1;  // the terminal's cursor, -1 when unknown
+AnsiStyle Ansi_style;              // SGR in effect, fg -2 when unknown
+char Ansi_lines[STATS_ROWS + 2][160]; // stats panel rows as on screen
+attr_t Ansi_line_attrs[STATS_ROWS + 2];
+int Ansi_stats_row = -1;
+char Ansi_info[128];               // the game info as on screen
+
+// The render thread draws the latest board frame the game loop published,
+// so a slow terminal never holds up the game clock; frames it hasn't got
+// to are replaced. Every ncurses call holds Curses_lock, and the game
+// thread's own drawing (see CursesLock) drops the frame pending
+std::thread Render_thread;
+std::recursive_timed_mutex Curses_lock;
+std::mutex Frame_lock;
+std::condition_variable Frame_wake;
+BoardFrame Frame_back;                // being composed by the game loop
+BoardFrame Frame_pending;             // guarded by Frame_lock
+BoardFrame Frame_drawn;               // being drawn by Render_thread
+int Frame_waiting = 0;                // Frame_pending not drawn yet
+std::atomic<int> Render_quit{0};
+int Frame_generation = 0;             // guarded by Curses_lock
+
+// Held by the game thread around its own drawing. Waits for the render
+// thread, and drops its pending frame: it is older than what's drawn now.
+// Effects that can be skipped only wait SKIP_DRAW_MS, so a stalled terminal
+// doesn't stall the game (check held)
+struct CursesLock {
+  int held;
+  CursesLock(int skippable = 0) {
+    held = 1;
+    if (!skippable) {
+      Curses_lock.lock();
+    } else {
+      held = Curses_lock.try_lock_for(std::chrono::milliseconds(SKIP_DRAW_MS));
+    }
+    if (held) {
+      Frame_generation++;
+    }
+  }
+  ~CursesLock() {
+    if (held) {
+      Curses_lock.unlock();
+    }
+  }
+};
+
+// Headless and benchmark runs (no terminal, no delays)
+int Headless = 0;
+int Bench = 0;
+int Maze_rows = -1;
+int Maze_cols = -1;
+unsigned int Seed = 0;
+long long Solve_ns = 0; // time spent in the last solve_maze_multi()
+long long Fields_ns = 0; // time spent on the last round's distance fields
+int Round_rows = 0;     // maze size of the last round
+int Round_cols = 0;
+
 // maze state
 Maze *maze;
 
+// Rewind log (see record_tick) and the recorded tick shown while paused
+int Rewind_mb = -1;                // budget in MB, 0 turns recording off
+int Rewind_on = 0;                 // recording this round
+std::deque<RewindSegment> Rewind;
+size_t Rewind_sealed = 0;          // bytes in all but the last segment
+int Rewind_steps = 0;              // ticks recorded this round
+std::vector<BotView> Rewind_last;  // the bots as last recorded
+int Rewind_at = -1;                // step shown, -1 for the live board
+std::vector<Cell> Rewind_grid;     // board at Rewind_at, bots drawn in
+std::vector<BotView> Rewind_bots;
+int Rewind_tick = 0;
+int Rewind_liv = 0;
+
+// Recording being written or replayed (see record_event)
+FILE *Record_file = NULL;
+const char *Replay_path = NULL;
+std::vector<uint8_t> Replay_data;  // the whole recording when replaying
+size_t Replay_pos = 0;
+size_t Replay_end = 0;             // where its events stop
+int Replay_complete = 0;           // it has its trailer: the game ended there
+int Record_monster = -1;           // last monster recorded this tick
+int Rounds_started = 0;            // cut short ones included
+int Jump_round = 0;                // --jump: play silently up to this round
+int Jump_tick = 0;                 // and tick
+int Exit_status = 0;
+
+// Snapshots of the game (see save_snapshot) and the one being resumed
+RoundStart Round_start;                    // what this round was made from
+const char *Snapshot_path = SNAPSHOT_FILENAME;
+volatile sig_atomic_t Snapshot_wanted = 0; // save at the end of the tick
+volatile sig_atomic_t Snapshot_quit = 0;   // and then quit
+const char *Resume_path = NULL;
+const uint8_t *Resume_map = NULL;          // mapped snapshot until caught up
+size_t Resume_size = 0;
+
+// State hash for --hash-trace: the XOR of a key per cell, bot and monster,
+// updated as they change (see hash_tick)
+FILE *Hash_file = NULL;
+uint64_t State_hash = 0;
+std::vector<uint64_t> Bot_hash;      // each bot's key in State_hash
+std::vector<uint64_t> Monster_hash;
+std::vector<uint64_t> Trail_hash;    // each bot's trail, only written by
+                                     // its own bot (see put_trail)
+std::vector<int> Hash_touched;       // battled this tick, bots as p and
+                                     // monsters as -1 - m
+
+// Win estimates for the stats panel, made by Win_thread from the bots as
+// last posted (see win_worker)
+std::thread Win_thread;
+std::mutex Win_lock;
+std::condition_variable Win_wake;
+std::vector<WinBot> Win_input;        // guarded by Win_lock
+int Win_input_round = 0;
+int Win_posted = 0;                   // new input waiting
+int Win_quit = 0;
+int Win_tick = -1;                    // Game_moves when last posted
+int Win_finished = 0;                 // Players_finished when last posted
+std::atomic<int> Win_permille[MAX_PLAYERS];
+std::atomic<int> Win_round{0};        // round the estimates are for
+
+// next round's layout, built by Layout_thread (see request_layout)
+Layout *Next_layout = NULL;
+std::thread Layout_thread;
+
 // FUNCTION PROTOTYPES ///////////////////////////////////////////////////////
+void add_bot_at(int p);
+void add_monster_at(int m);
+void adapt_pacing(long long output_ns, int cells);
+void **alloc_plane(int rows, int cols, size_t size);
 void animate_bullseye(int y, int x, int max_radius, int delay_ms, int direction);
+static void ansi_cells(const Cell *row, int from, int to);
+static int  ansi_color(char *sgr, size_t size, int c, int base);
+void ansi_draw_stats(const BoardFrame *f);
+void ansi_flush();
+static void ansi_move(const Cell *row, int i, int j);
+static AnsiStyle ansi_pair_style(short pair, attr_t attrs);
+static inline void ansi_put(const char *text, size_t len);
+static void ansi_set_style(AnsiStyle s);
+static void ansi_text(int i, int j, const char *text, attr_t attrs, int clear);
+void assign_start_goal(const Maze *m, int idx, Position *start, Position *end);
+BotTask astar_bot(int p);
 int  battle_bot_monster(int monster_index, int player_id);
 int  battle_bots(int player1_id, int player2_id);
 int  battle_monsters(int monster1_idx, int monster2_idx);
-int  battle_unified(int combatant1_idx, int combatant2_idx, int type);
+BotTask best_first_bot(int p, int astar);
+int  bot_near(int q, const LeapSpan *a, int reach);
+void build_junction_graph();
+void build_flow_field();
+void build_glyphs();
+void compose_maze(BoardFrame *f);
+void compose_stats(BoardFrame *f);
+void build_layout(Layout *l);
+void bot_view(int p, BotView *v);
+int  bot_color_pair(int idx);
+const char *bot_long_name(int player_id);
+const char *bot_name(int idx);
 void calc_game_speed();
-int  calculate_score(int moves, int width, int height);
+void catch_bot(int i);
+void check_battles_lost(int p);
+int  calculate_score(int moves, int optimal);
 int  check_monster(int x, int y);
 int  check_teleporter(int x, int y, int *newX, int *newY);
+void collide_monster(int i);
 void clear_stack(Node **stack);
-void create_maze(int rows, int cols);
+void compute_distance_field(int p);
+int  corridor_leap(int p, Position *pos);
+Maze *create_maze(int rows, int cols);
 void delay_with_polling(long total_delay_ms);
+BotTask dfs_bot(int p);
+void dfs_outcome(int p);
 void display_high_scores_window(int count, HighScore best_scores[], HighScore worst_scores[]);
 void display_player_alert(int p_idx, int rank);
 void display_player_stats();
-void ensure_path_between_corners();
+void draw_battler(int col, int is_bot, int idx, int strength, int wins);
+void ensure_path_between_corners(Maze *m);
+int  entity_period(int base);
 void exit_game(const char *format, ...);
-void free_maze();
-void generate_maze();
-char get_player_solution_char(int player_id);
-char get_player_visited_char(int player_id);
-char get_player_current_char(int player_id);
+void estimate_wins(const std::vector<WinBot> &bots, uint64_t *rng, int *permille);
+void expand_bot(int p, Position current);
+int  first_player_at(int x, int y);
+int  flood_fill_bits(const BitPlane *open, BitPlane *reach);
+void flood_fill_scalar(const BitPlane *open, BitPlane *reach);
+void follow_bot(int p);
+Layout *finish_layout();
+void free_layout(Layout *l);
+void free_maze(Maze *m);
+void free_plane(void **plane, int rows);
+void generate_maze(Maze *m, uint64_t *rng);
+BotTask greedy_bot(int p);
+Cell get_player_solution_char(int player_id);
+Cell get_player_visited_char(int player_id);
+Cell get_player_current_char(int player_id);
+static inline uint64_t hash_mix(uint64_t h, uint64_t v);
+void hash_start();
+void hash_tick();
 void highlight_player_solution_path(int p);
 void init();
+void init_ansi();
+void init_colors();
 void initialize_players(int stage);
+void install_layout(Layout *l);
 void insert_high_score(HighScore scores[], int *count, HighScore new_score, int is_best);
-int  is_dead_end(int x, int y);
+void invalidate_rows(int from, int to);
+void invalidate_shadow();
+int  is_dead_end(const Maze *m, int x, int y);
 int  is_empty(Node *stack);
-int  is_player_position(int x, int y, Position *current_pos);
+int  is_end_cell(Cell c);
+static inline int goal_moves(int p, int x, int y);
+static inline int in_view(int y, int x);
+static inline int layout_rand(uint64_t *rng);
+int  leading_bot();
+int  leap_clear(int p, const LeapSpan *span, int len);
+void load_open_bits(const Maze *m, BitPlane *open);
+int  load_replay(const char *path);
+int  load_snapshot(const char *path);
 void logMessage(const char *format, ...);
+Layout *make_layout(int term_rows, int term_cols, uint64_t seed);
+void make_bot_glyphs(int idx, char *current_glyph, char *end_glyph);
+void make_bot_names(int idx, char *name, char *long_name);
+void make_tick_order();
+void mark_corridor(int p, Position landing, int len);
+static inline int marks_at(int p, int x, int y);
+long long monotonic_ns();
+void move_bot(int p, Position pos);
+void move_monster(int m, int x, int y);
+static inline void note_frontier(int p, int x, int y, int delta);
+static inline int monster_can_enter(Cell c);
+void move_monster_turn(int i);
 void mysleep(long total_delay_ms);
+BotTask oracle_bot(int p);
+void parallel_for(int n, void (*job)(int));
 void pauseForUser();
+void patrol_step(int i);
 void pauseGame();
-void place_monsters();
-void place_teleporters();
+void pace_ticks(int span);
+void pan_view(int dy, int dx);
+int  parse_strategies(const char *list);
+void place_view();
+void place_monsters(Layout *l, uint64_t *rng);
+void place_teleporters(Layout *l, uint64_t *rng);
+void pool_worker(int t);
+void post_win_estimate();
+void publish_frame();
 Position pop_stack(Node **stack);
-static inline void print_char(int i, int j, char ichar);
+void present_battle(const BattleOutcome *b);
+static inline void draw_cell(Cell ichar);
+int draw_frame(const BoardFrame *f);
+int draw_maze(const BoardFrame *f, int budget);
+void draw_stats(const BoardFrame *f);
+static void set_glyph(Cell c, const char *text, attr_t attrs, short pair);
+static inline int find_change(const Cell *a, const Cell *b, int from, int n);
+static inline void print_char(int i, int j, Cell ichar);
 void print_maze();
+void propose_move(int p);
+void propose_due(int i);
+void propose_move_direct(int p);
+void record_end();
+void record_event(uint64_t v);
+uint64_t record_field(uint64_t v);
+void record_header();
+void record_tick();
+void pursue_step(int i);
 void push_stack(Node **stack, Position pos);
+static inline void put_marks(int p, int x, int y, int marks);
+static inline void put_trail(int p, int x, int y, char trail);
+const char *rank_suffix(int rank);
+void remove_bot_at(int p);
+void render_worker();
+void report_round();
+void request_layout(int term_rows, int term_cols, uint64_t seed);
+void remove_monster_at(int m);
+BattleOutcome resolve_battle(int type, int left, int right);
+void resolve_collisions(int p);
+void resolve_moves();
+void retreat_bot(int p);
+size_t rewind_bytes();
+void rewind_clear();
+void round_size(int *rows, int *cols);
+void rewind_start();
+void rewind_step(int delta);
+int  reach_from(const BitPlane *open, BitPlane *reach, int x, int y);
+void resize_monsters(int n);
+void resize_players(int n);
+void resume_check();
+static inline const SnapshotHeader *resume_header();
+const SnapshotHeader *resume_round();
+void run_bench();
+void run_flood_bench();
+void run_render_bench();
+void run_strategy_bench();
 int  read_high_scores(HighScore best_scores[], HighScore worst_scores[]);
 int  read_keyboard();
+int  replay_cut_short();
 void run_round();
 void save_high_scores(HighScore best_scores[], HighScore worst_scores[], int count);
-void show_battle_art(int aart, int leftside, int type, int player, int left_idx, int right_idx);
+int  save_snapshot();
+size_t snapshot_bytes(int rows, int cols, int bots, int mons, int strategies);
+void snapshot_now();
+static inline void set_cell(int x, int y, Cell c);
+void set_trail(int p, int x, int y, int px, int py);
+void settle_bot(int p);
 void shuffle_directions_for_player(int idx);
 void sleep_millis(long ms);
+BotTask start_controller(int p);
+uint64_t splitmix64(uint64_t *state);
+void start_pool();
+void stop_pool();
+void stop_render_thread();
+void stop_win_thread();
 void solve_maze_multi();
-void update_high_scores(int rows, int cols);
+void take_stale_rows();
+static inline char trail_at(int p, int x, int y);
+int  trail_parent(int p, int *x, int *y);
+void update_high_scores();
 void update_monsters();
 void update_status_line(const char *format, ...);
+void win_worker();
 void show_help_window();
 void show_extended_help_window();
 void shuffleArray(const char* in[], char* out[], int n);
+BotTask tremaux_bot(int p);
+BotTask wall_follower_bot(int p);
 
 // FUNCTION DEFS /////////////////////////////////////////////////////////////
 
 // MAIN function
 int main(int argc, char *argv[]) {
   int opt;
+  int seeded = 0;
+  const char *record_path = NULL;
+  const char *hash_path = NULL;
   struct winsize size;
+  // long-only options use codes above the char range
+  enum { OPT_HEADLESS = 256, OPT_ROWS, OPT_COLS, OPT_SEED, OPT_BENCH,
+         OPT_SPREAD, OPT_STRATEGY, OPT_BENCH_STRATEGIES, OPT_CORRIDORS,
+         OPT_BENCH_FLOOD, OPT_REWIND_MB, OPT_RECORD, OPT_REPLAY, OPT_JUMP,
+         OPT_SNAPSHOT, OPT_RESUME, OPT_HASH_TRACE, OPT_PURSUIT,
+         OPT_BENCH_RENDER, OPT_TPS, OPT_FPS, OPT_ANSI };
+  static const struct option long_options[] = {
+      {"headless", no_argument,       NULL, OPT_HEADLESS},
+      {"rows",     required_argument, NULL, OPT_ROWS},
+      {"cols",     required_argument, NULL, OPT_COLS},
+      {"seed",     required_argument, NULL, OPT_SEED},
+      {"bench",    no_argument,       NULL, OPT_BENCH},
+      {"speed-spread", required_argument, NULL, OPT_SPREAD},
+      {"strategy", required_argument, NULL, OPT_STRATEGY},
+      {"bench-strategies", no_argument, NULL, OPT_BENCH_STRATEGIES},
+      {"corridors", no_argument,      NULL, OPT_CORRIDORS},
+      {"bench-flood", no_argument,    NULL, OPT_BENCH_FLOOD},
+      {"bench-render", no_argument,   NULL, OPT_BENCH_RENDER},
+      {"rewind-mb", required_argument, NULL, OPT_REWIND_MB},
+      {"record",   required_argument, NULL, OPT_RECORD},
+      {"replay",   required_argument, NULL, OPT_REPLAY},
+      {"jump",     required_argument, NULL, OPT_JUMP},
+      {"snapshot", required_argument, NULL, OPT_SNAPSHOT},
+      {"resume",   required_argument, NULL, OPT_RESUME},
+      {"hash-trace", required_argument, NULL, OPT_HASH_TRACE},
+      {"pursuit",  no_argument,       NULL, OPT_PURSUIT},
+      {"tps",      required_argument, NULL, OPT_TPS},
+      {"fps",      required_argument, NULL, OPT_FPS},
+      {"ansi",     optional_argument, NULL, OPT_ANSI},
+      {"help",     no_argument,       NULL, 'h'},
+      {NULL, 0, NULL, 0}};
 
   // Process command line arguments
-  while ((opt = getopt(argc, argv, "t:m:s:g:r:p:kwh")) != -1) {
+  while ((opt = getopt_long(argc, argv, "t:m:n:j:s:g:r:p:kwh", long_options,
+                            NULL)) != -1) {
     switch (opt) {
+    case OPT_HEADLESS:
+      Headless = 1;
+      break;
+    case OPT_ROWS:
+      Maze_rows = atoi(optarg);
+      break;
+    case OPT_COLS:
+      Maze_cols = atoi(optarg);
+      break;
+    case OPT_SEED:
+      Seed = (unsigned int) strtoul(optarg, NULL, 0);
+      seeded = 1;
+      break;
+    case OPT_BENCH:
+      Bench = Headless = 1;
+      break;
+    case OPT_SPREAD:
+      Speed_spread = atoi(optarg);
+      break;
+    case OPT_STRATEGY:
+      if (!parse_strategies(optarg)) {
+        fprintf(stderr, "Unknown strategy in '%s'\n", optarg);
+        return 1;
+      }
+      break;
+    case OPT_BENCH_STRATEGIES:
+      Bench = 2;
+      Headless = 1;
+      break;
+    case OPT_CORRIDORS:
+      Use_corridors = 1;
+      break;
+    case OPT_BENCH_FLOOD:
+      Bench = 3;
+      Headless = 1;
+      break;
+    case OPT_BENCH_RENDER:
+      Bench = 4;
+      Headless = 1;
+      break;
+    case OPT_REWIND_MB:
+      Rewind_mb = atoi(optarg);
+      break;
+    case OPT_RECORD:
+      record_path = optarg;
+      break;
+    case OPT_REPLAY:
+      Replay_path = optarg;
+      break;
+    case OPT_JUMP:
+      // [ROUND:]TICK
+      if (strchr(optarg, ':')) {
+        Jump_round = atoi(optarg);
+        Jump_tick = atoi(strchr(optarg, ':') + 1);
+      } else {
+        Jump_round = 1;
+        Jump_tick = atoi(optarg);
+      }
+      break;
+    case OPT_SNAPSHOT:
+      Snapshot_path = optarg;
+      break;
+    case OPT_RESUME:
+      Resume_path = optarg;
+      break;
+    case OPT_HASH_TRACE:
+      hash_path = optarg;
+      break;
+    case OPT_PURSUIT:
+      Monster_pursuit = 1;
+      break;
+    case OPT_TPS:
+      Tick_rate = atoi(optarg);
+      break;
+    case OPT_FPS:
+      Frame_rate = atoi(optarg);
+      break;
+    case OPT_ANSI:
+      // [auto|16|truecolor]
+      Use_ansi = 1;
+      if (!optarg || strcmp(optarg, "auto") == 0) {
+        Ansi_truecolor = -1;
+      } else if (strcmp(optarg, "16") == 0) {
+        Ansi_truecolor = 0;
+      } else if (strcmp(optarg, "truecolor") == 0) {
+        Ansi_truecolor = 1;
+      } else {
+        fprintf(stderr, "Unknown --ansi colours '%s'\n", optarg);
+        return 1;
+      }
+      break;
     case 't':
       Num_teleporters = atoi(optarg);
       break;
     case 'm':
       Num_monsters = atoi(optarg);
       break;
+    case 'n':
+      Num_players = atoi(optarg);
+      break;
+    case 'j':
+      Num_threads = atoi(optarg);
+      break;
     case 's':
       Max_monster_strength = atoi(optarg);
       break;
@@ -344,7 +1236,12 @@ int main(int argc, char *argv[]) {
       printf("Options:\n");
       printf("  -t N    Set number of teleporter pairs (default: "
              "auto-calculated)\n");
-      printf("  -m N    Set number of monsters (default: auto-calculated)\n");
+      printf("  -m N    Set number of monsters (0-%d, default: auto-calculated)\n",
+             MAX_MONSTERS);
+      printf("  -n N    Set number of bots (1-%d, default: %d)\n", MAX_PLAYERS,
+             DEF_PLAYERS);
+      printf("  -j N    Set worker threads for bot moves (1-%d, default: auto)\n",
+             MAX_THREADS);
       printf("  -s N    Set maximum monster strength (1-%d, default: %d)\n",
              MAX_MONSTER_STRENGTH, DEF_MONSTER_STRENGTH);
       printf("  -g N    Set game speed (1-100, default: %d)\n", DEF_GAME_SPEED);
@@ -352,6 +1249,46 @@ int main(int argc, char *argv[]) {
       printf("  -k      Wait for key-press to continue (default: No)\n");
       printf("  -w      Show battle windows (default: No)\n");
       printf("  -h      Display this help message\n");
+      printf("  --headless   Run without a terminal and print the results\n");
+      printf("  --rows N     Maze rows (default: the screen's, headless: %d)\n",
+             DEF_HEADLESS_ROWS);
+      printf("  --cols N     Maze columns (default: the screen's, headless: %d)\n",
+             DEF_HEADLESS_COLS);
+      printf("  --seed N     Seed the random numbers (default: time)\n");
+      printf("  --bench      Time the bot scheduler, headless (rounds: -r, "
+             "default: %d)\n", DEF_BENCH_ROUNDS);
+      printf("  --speed-spread N  Vary each bot and monster speed by up to "
+             "+/-N%% (0-%d, default: 0)\n", MAX_SPEED_SPREAD);
+      printf("  --strategy S[,S...]  Bot strategies, cycled through the bots "
+             "(default: dfs)\n");
+      printf("               dfs, wall, tremaux, greedy, astar, oracle\n");
+      printf("  --bench-strategies  Compare the strategies, headless "
+             "(rounds: -r, default: %d)\n", DEF_BENCH_ROUNDS);
+      printf("  --corridors  Headless DFS bots cross corridors in one step\n");
+      printf("  --bench-flood  Time the flood fills on 1k and 10k mazes\n");
+      printf("  --bench-render  Time drawing a %dx%d board and count the "
+             "bytes, per renderer\n", RENDER_BENCH_COLS, RENDER_BENCH_ROWS);
+      printf("  --rewind-mb N  Memory for rewinding while paused (0-%d, "
+             "default: %d, headless: 0)\n", MAX_REWIND_MB, DEF_REWIND_MB);
+      printf("  --record FILE  Record the game's seed, options and events\n");
+      printf("  --replay FILE  Play a recording again, checking every event\n");
+      printf("  --jump [R:]T   Replay silently up to round R (default 1), "
+             "tick T\n");
+      printf("  --snapshot FILE  Where the s key and SIGUSR1 save the game "
+             "(default: %s)\n", SNAPSHOT_FILENAME);
+      printf("  --resume FILE  Carry on from a snapshot\n");
+      printf("  --hash-trace FILE  Write a hash of the game state after "
+             "each tick\n");
+      printf("  --pursuit    Monsters chase the nearest bot instead of "
+             "patrolling\n");
+      printf("  --tps N      Play N ticks per second, whatever -g says "
+             "(1-%d)\n", MAX_TICK_RATE);
+      printf("  --fps N      Draw at most N frames per second, playing the "
+             "ticks between\n               (0-%d, 0: every tick, default: "
+             "%d with --tps, else 0)\n", MAX_FRAME_RATE, DEF_FRAME_RATE);
+      printf("  --ansi[=C]   Draw the board with ANSI escapes, one write per "
+             "frame\n               (C: auto, 16 or truecolor; default: "
+             "auto)\n");
       return 0;
     default:
       fprintf(stderr, "Try '%s -h' for more information.\n", argv[0]);
@@ -359,11 +1296,83 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // Corridor leaps skip the cell by cell animation, so headless only
+  if (!Headless) {
+    Use_corridors = 0;
+  }
+
   // Set the random seed
-  srand(static_cast<unsigned int>(time(NULL)));
+  if (!seeded) {
+    Seed = static_cast<unsigned int>(time(NULL));
+  }
+
+  // Recordings: a replay takes the seed and options from the recording
+  if (Bench && (record_path || Replay_path)) {
+    fprintf(stderr, "Benchmarks can't be recorded or replayed\n");
+    return 1;
+  }
+  if (record_path && Replay_path) {
+    fprintf(stderr, "Use one of --record and --replay\n");
+    return 1;
+  }
+  // Snapshots: a resumed game takes the seed and options from the snapshot
+  if (Resume_path && (Bench || record_path || Replay_path)) {
+    fprintf(stderr, "A resumed game can't be benchmarked, recorded or "
+                    "replayed\n");
+    return 1;
+  }
+  if (Resume_path && !load_snapshot(Resume_path)) {
+    fprintf(stderr, "Can't resume from '%s': not a maze4 snapshot\n",
+            Resume_path);
+    return 1;
+  }
+  if (Use_corridors && !Headless) {
+    fprintf(stderr, "'%s' was saved with --corridors, resume it with "
+                    "--headless\n", Resume_path);
+    return 1;
+  }
+  if (Replay_path && !load_replay(Replay_path)) {
+    fprintf(stderr, "Can't replay '%s': not a maze4 recording\n", Replay_path);
+    return 1;
+  }
+  if (record_path) {
+    Record_file = fopen(record_path, "wb");
+    if (!Record_file) {
+      perror(record_path);
+      return 1;
+    }
+    fputs(RECORD_MAGIC, Record_file);
+    putc(RECORD_VERSION, Record_file);
+  }
+  record_header();
+  srand(Seed);
+  if (hash_path) {
+    Hash_file = fopen(hash_path, "w");
+    if (!Hash_file) {
+      perror(hash_path);
+      return 1;
+    }
+  }
 
   // init game  
   init();
+  if (Resume_map) {
+    Game_roundsB = resume_header()->rounds_total; // rounds count from the first
+  }
+
+  if (Bench == 1) {
+    run_bench();
+    exit_game("");
+  } else if (Bench == 2) {
+    run_strategy_bench();
+    exit_game("");
+  } else if (Bench == 3) {
+    run_flood_bench();
+    exit_game("");
+  } else if (Bench == 4) {
+    run_render_bench();
+    exit_game("");
+  }
 
   // loop for the game rounds  
   for (; Game_rounds > 0; Game_rounds--) {
@@ -373,38 +1382,48 @@ int main(int argc, char *argv[]) {
       Screen_reduced = 0;
       Game_rounds++;
     }
+    if (Headless) {
+      report_round();
+      continue;
+    }
     // make sceen match reported size
     ioctl(STDOUT_FILENO, TIOCGWINSZ, &size); 
-    resizeterm(size.ws_row, size.ws_col);
+    {
+      CursesLock lock;
+      resizeterm(size.ws_row, size.ws_col);
+      getmaxyx(stdscr, Term_rows, Term_cols);
+    }
     old_rows = size.ws_row ; old_cols = size.ws_col;      
   }
 
   // leave game
+  if (Replay_path && !Replay_complete) {
+    Exit_status = 2;
+    exit_game("%s is cut off after round %d: it has no end of game\n",
+              Replay_path, Rounds_started);
+  }
+  if (Replay_path && Replay_pos != Replay_end) {
+    Exit_status = 2;
+    exit_game("%s goes on after the game's end, at byte %zu of %zu\n",
+              Replay_path, Replay_pos, Replay_end);
+  }
+  if (Replay_path) {
+    exit_game("Replay of %s matched: %d rounds, %zu bytes\n", Replay_path,
+              Rounds_started, Replay_pos);
+  }
   exit_game("Game over\n");
 }
 
-// init (one time)
-void init() {
-  struct winsize size;
-
-  // Set locale for UTF-8 support
-  setlocale(LC_ALL, "");
+// Snapshot signals: saved at the end of the tick being played
+static void snapshot_signal(int sig) {
+  Snapshot_wanted = 1;
+  if (sig != SIGUSR1) {
+    Snapshot_quit = 1;
+  }
+}
 
-  // Initialize ncurses
-  initscr();
-  cbreak();
-  noecho();
-  keypad(stdscr, TRUE);
-  curs_set(0);
-  start_color();
-  use_default_colors();
-  mousemask(ALL_MOUSE_EVENTS | REPORT_MOUSE_POSITION, NULL);
-  printf("\033[?1003h\n");  // Enable mouse movement events
-
-  // Set up the resize handler
-  signal(SIGWINCH, SIG_IGN);
-
-  // Define color pairs
+// Define the colour pairs
+void init_colors() {
   init_pair(1, COLOR_BLACK, -1);            // Path
   init_pair(2, COLOR_RED, -1);              // Player 1
   init_pair(3, COLOR_CYAN, -1);             // Player 2
@@ -422,11 +1441,63 @@ void init() {
   init_pair(14, COLOR_YELLOW, COLOR_BLACK);
   init_pair(15, COLOR_BLUE, COLOR_BLACK);
   init_pair(16, COLOR_CYAN, COLOR_BLACK);
+  // extra bot colours (see BOT_COLOR_PAIRS)
+  init_pair(17, COLOR_MAGENTA, -1);
+  init_pair(18, COLOR_BLUE, -1);
+  init_pair(19, COLOR_WHITE, -1);
+}
+
+// What --ansi can send this terminal
+void init_ansi() {
+  const char *colorterm = getenv("COLORTERM");
+  if (Ansi_truecolor < 0) {
+    Ansi_truecolor = colorterm && (strcmp(colorterm, "truecolor") == 0 ||
+                                   strcmp(colorterm, "24bit") == 0);
+  }
+  char cap[] = "rep";
+  char *rep = tigetstr(cap);
+  Ansi_rep = rep != NULL && rep != (char *) -1;
+}
+
+// init (one time)
+void init() {
+  struct winsize size;
+
+  // Set locale for UTF-8 support
+  setlocale(LC_ALL, "");
+
+  if (!Headless) {
+    // Initialize ncurses
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    start_color();
+    use_default_colors();
+    mousemask(ALL_MOUSE_EVENTS | REPORT_MOUSE_POSITION, NULL);
+    printf("\033[?1003h\n");  // Enable mouse movement events
+
+    // Set up the resize handler
+    signal(SIGWINCH, SIG_IGN);
+
+    init_colors();
+    init_ansi();
+    Input_win = newwin(1, 1, 0, 0);
+    keypad(Input_win, TRUE);
+    nodelay(Input_win, TRUE);
+    untouchwin(Input_win);
+  }
 
   calc_game_speed();
+  Tick_rate = Tick_rate < 0 ? 0 : MIN(Tick_rate, MAX_TICK_RATE);
+  if (Frame_rate < 0) {
+    Frame_rate = Tick_rate ? DEF_FRAME_RATE : 0;
+  }
+  Frame_rate = MIN(Frame_rate, MAX_FRAME_RATE);
 
   if (Game_rounds < 0) {
-    Game_rounds = 1;
+    Game_rounds = Bench ? DEF_BENCH_ROUNDS : 1;
   }
   Game_roundsB = Game_rounds;
   if (WaitForKey < 0) {
@@ -438,10 +1509,48 @@ void init() {
   if (pauseTime < 0) {
     pauseTime = 2 * 1000;
   }
+  if (Num_players < 0) {
+    Num_players = DEF_PLAYERS;
+  }
+  Speed_spread = Speed_spread < 0 ? 0 : MIN(Speed_spread, MAX_SPEED_SPREAD);
+  // nobody can pause a headless game, so only record when asked to
+  if (Rewind_mb < 0) {
+    Rewind_mb = Headless ? 0 : DEF_REWIND_MB;
+  }
+  Rewind_mb = MIN(Rewind_mb, MAX_REWIND_MB);
+  Num_players = Num_players < 1
+                    ? 1
+                    : (Num_players > MAX_PLAYERS ? MAX_PLAYERS : Num_players);
+  // only worth having worker threads when there are many bots
+  if (Num_players >= PARALLEL_MIN_ITEMS) {
+    start_pool();
+  }
+
+  // SIGUSR1 saves a snapshot, SIGTERM and SIGHUP save one and quit. Not
+  // restarted, so a paused game's getch() wakes up for it (see pauseGame)
+  if (!Bench) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = snapshot_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+  }
+
+  if (Headless) {
+    // no battle windows, pauses or animations without a terminal
+    ShowWindows = 0;
+    WaitForKey = 0;
+    pauseTime = 0;
+    Game_delay = 0;
+    return;
+  }
 
   // make sceen match reported size
   ioctl(STDOUT_FILENO, TIOCGWINSZ, &size); 
   resizeterm(size.ws_row, size.ws_col);
+  getmaxyx(stdscr, Term_rows, Term_cols);
   old_rows = size.ws_row ; old_cols = size.ws_col;
   logMessage("Init term size is %d, %d", size.ws_row, size.ws_col);
 }
@@ -450,11 +1559,29 @@ void init() {
 void run_round() {
   int rows, cols, maze_area;
 
+  // Each round reseeds the random numbers, so that a snapshot only needs
+  // the round's seed to play it again up to where it was saved
+  Rounds_started++;
+  const SnapshotHeader *resume = resume_round();
+  Round_start.rand_seed = resume ? resume->start.rand_seed : (unsigned) rand();
+  srand(Round_start.rand_seed);
+  uint64_t fresh_seed = (uint64_t) rand(); // if there's no layout waiting
+
   // Initialize players
   initialize_players(0);
-
-  // Get terminal dimensions
-  getmaxyx(stdscr, rows, cols);
+  rewind_clear(); // last round's log is for another maze
+
+  round_size(&rows, &cols);
+  // Recorded and resumed rounds keep the terminal size they were played in
+  rows = (int) record_field((uint64_t) rows);
+  cols = (int) record_field((uint64_t) cols);
+  if (resume) {
+    rows = resume->start.term_rows;
+    cols = resume->start.term_cols;
+    Num_teleporters = resume->start.num_teleporters;
+    Num_monsters = resume->start.num_monsters;
+    Max_monster_strength = resume->start.max_strength;
+  }
   maze_area = rows * cols;
 
   // Calculate default max values based on screen size if not provided
@@ -468,8 +1595,8 @@ void run_round() {
                         : (Num_teleporters > MAX_TELEPORTERS ? MAX_TELEPORTERS
                                                              : Num_teleporters);
   if (Num_monsters < 0) {
-    // 1 monster per 20 cells, with a minimum of 1 and maximum of MAX_MONSTERS
-    Num_monsters = maze_area / DEF_MONSTER_DENSITY;
+    // 1 monster per 500 cells, with a maximum of DEF_MAX_MONSTERS
+    Num_monsters = MIN(maze_area / DEF_MONSTER_DENSITY, DEF_MAX_MONSTERS);
   }
   Num_monsters =
       Num_monsters < 0
@@ -483,59 +1610,439 @@ void run_round() {
                              : (Max_monster_strength > MAX_MONSTER_STRENGTH
                                     ? MAX_MONSTER_STRENGTH
                                     : Max_monster_strength);
-  // Ensure minimum maze size
+  // Ensure minimum maze size (a bigger one is shown a screenful at a time)
   if (rows < MIN_ROWS || cols < MIN_COLS) {
     exit_game("Screen too small, min %d rows, %d cols\n", MIN_ROWS, MIN_COLS);
   }
-  // Ensure maximum maze size
-  if (rows > MAX_ROWS || cols > MAX_COLS) {
-    exit_game("Screen too big, max %d rows, %d cols\n", MAX_ROWS, MAX_COLS);
-  }
-  // Adjust for maze walls and borders
-  rows = (rows - 6) / 2 * 2 - 1; // Reserve space for messages and player stats
-  cols = (cols - 2) / 2 * 2 - 1;
-  // Ensure rows and cols are odd, even if initial calculation is even.
-  if (rows % 2 == 0)
-    rows--;
-  if (cols % 2 == 0)
-    cols--;
-
-  // Create and initialize maze
-  create_maze(rows, cols);
+
+  // Use the layout made while the last round was played, unless the
+  // terminal has changed since; otherwise make it now
+  Layout *layout = finish_layout();
+  if (layout && (!layout->maze || layout->term_rows != rows ||
+                 layout->term_cols != cols ||
+                 layout->num_teleporters != Num_teleporters ||
+                 layout->num_monsters != Num_monsters ||
+                 layout->max_strength != Max_monster_strength)) {
+    // same seed, so a resize doesn't change which maze comes next
+    uint64_t seed = layout->seed;
+    free_layout(layout);
+    layout = make_layout(rows, cols, seed);
+    build_layout(layout);
+  } else if (!layout) {
+    layout = make_layout(rows, cols,
+                         resume ? resume->start.layout_seed : fresh_seed);
+    build_layout(layout);
+  }
+  Round_start.layout_seed = layout->seed;
+  Round_start.term_rows = rows;
+  Round_start.term_cols = cols;
+  Round_start.num_teleporters = Num_teleporters;
+  Round_start.num_monsters = Num_monsters;
+  Round_start.max_strength = Max_monster_strength;
+  maze = layout->maze;
+  layout->maze = NULL;
   if (!maze) {
     exit_game("Failed to allocate memory for maze\n");
   }
-
-  // Generate maze using enhanced DFS for paths between corners
-  generate_maze();
-
-  // Implement and call ensure_path_between_corners
-  ensure_path_between_corners();
+  Round_rows = maze->rows;
+  Round_cols = maze->cols;
 
     // Finish initializing players
     initialize_players(1);
     
-  // Place teleporters and monsters
-  place_teleporters();
-  place_monsters();
+  // Bring in the teleporters and monsters
+  install_layout(layout);
+  free_layout(layout);
   Liv_monsters = Num_monsters;
 
+  // Start on the next round's layout while this one is played (the seed
+  // is drawn either way, so a round plays the same whatever -r says)
+  uint64_t next_seed = (uint64_t) rand();
+  if (!Bench && Game_rounds > 1) {
+    request_layout(rows, cols, next_seed);
+  }
+  build_junction_graph();
+
+  // Exact distances to every goal, for the scores and the strategies
+  long long fields_ns = monotonic_ns();
+  Node_dist.resize((size_t) Num_players * (size_t) Junctions.num_nodes);
+  parallel_for(Num_players, compute_distance_field);
+  Fields_ns = monotonic_ns() - fields_ns;
+
+  // Replaying with --jump or resuming: nothing to show before the round
+  // and tick
+  Fast_forward = Jump_round > Rounds_started ||
+                 (Jump_round == Rounds_started && Jump_tick > 0) ||
+                 resume != NULL;
+
   // Print initial maze
-  clear();
-  print_maze();
-  display_player_stats();
-  pauseForUser();
-  update_status_line("The race is ON!");
-  LastSLupdate = 1;
+  if (!Headless) {
+    CursesLock lock;
+    clear();
+    invalidate_shadow();
+    View_panned = 0; // a new maze, the view starts on the bot it follows
+    print_maze();
+    display_player_stats();
+    pauseForUser();
+    update_status_line("The race is ON!");
+    LastSLupdate = 1;
+  }
 
   // Solve maze concurrently for all players
+  long long start_ns = monotonic_ns();
   solve_maze_multi();
+  Solve_ns = monotonic_ns() - start_ns;
 
   // highscore
-  if(!Screen_reduced) update_high_scores(rows, cols);
+  if (!Screen_reduced && !Headless && !Replay_path) update_high_scores();
 
   // Clean up
-  free_maze();
+  free_maze(maze);
+  maze = NULL;
+}
+
+// Headless: print the standings of the round just played
+void report_round() {
+  int total_moves = 0;
+
+  for (int p = 0; p < Num_players; p++) {
+    total_moves += players.moves[p];
+  }
+  printf("Round %d: %dx%d maze, %d bots, %d ticks, %d moves, %.3f ms "
+         "(distance fields %.3f ms)\n",
+         Game_roundsB - Game_rounds + 1, Round_rows, Round_cols,
+         Num_players, Game_moves, total_moves, (double) Solve_ns / 1e6,
+         (double) Fields_ns / 1e6);
+  for (int p = 0; p < Num_players; p++) {
+    char result[16];
+    if (players.reached_goal[p]) {
+      snprintf(result, sizeof(result), "%d%s", players.finished_rank[p],
+               rank_suffix(players.finished_rank[p]));
+    } else {
+      snprintf(result, sizeof(result), "DNF");
+    }
+    printf("  %-5s %-15s %-7s %6d moves %6d best  %3d won  %3d lost  "
+           "str %2d",
+           result, players.info[p].long_name,
+           STRATEGY_NAMES[players.info[p].strategy], players.moves[p],
+           players.optimal[p], players.battles_won[p],
+           players.battles_lost[p], players.strength[p]);
+    if (players.reached_goal[p]) {
+      printf("  %.2fx", (double) players.moves[p] / players.optimal[p]);
+    }
+    printf("\n");
+  }
+  if (Rewind_on) {
+    printf("  rewind: last %d of %d ticks kept, %d checkpoints, %.1f MB\n",
+           Rewind_steps - Rewind.front().first_step, Rewind_steps,
+           (int) Rewind.size(), (double) rewind_bytes() / (1 << 20));
+  }
+}
+
+// Benchmark the bot scheduler: play the same seeded rounds with the
+// coroutine controllers, with the inline DFS step and with corridor leaps
+// and compare the steps played and the time per bot move. Only the first
+// two play the same games
+void run_bench() {
+  const char *labels[] = {"inline loop", "coroutines", "corridors"};
+  long long ns[3] = {0, 0, 0};
+  long long moves[3] = {0, 0, 0};
+  long long steps[3] = {0, 0, 0};
+  long long ticks[3] = {0, 0, 0};
+  long long nodes = 0, edges = 0, cells = 0;
+  int rounds = Game_rounds;
+
+  printf("bench: %d rounds, %d bots, seed %u\n", rounds, Num_players, Seed);
+  for (int mode = 0; mode < 3; mode++) {
+    Use_coroutines = mode > 0;
+    Use_corridors = mode == 2;
+    for (int r = 0; r < rounds; r++) {
+      srand(Seed + (unsigned int) r);
+      run_round();
+      ns[mode] += Solve_ns;
+      ticks[mode] += Game_moves;
+      steps[mode] += Steps_played;
+      for (int p = 0; p < Num_players; p++) {
+        moves[mode] += players.moves[p];
+      }
+      if (mode == 2) {
+        nodes += Junctions.num_nodes;
+        edges += Junctions.num_edges;
+        cells += Junctions.open_cells;
+      }
+    }
+  }
+  Use_corridors = 0;
+  printf("maze %dx%d, junction graph: %.0f of %.0f open cells are nodes, "
+         "%.0f corridors\n", Round_rows, Round_cols, (double) nodes / rounds,
+         (double) cells / rounds, (double) edges / rounds);
+  printf("%-12s %10s %10s %12s %10s %9s\n", "scheduler", "ticks", "steps",
+         "moves", "ms", "ns/move");
+  for (int mode = 0; mode < 3; mode++) {
+    printf("%-12s %10lld %10lld %12lld %10.2f %9.1f\n", labels[mode],
+           ticks[mode], steps[mode], moves[mode], (double) ns[mode] / 1e6,
+           moves[mode] ? (double) ns[mode] / (double) moves[mode] : 0.0);
+  }
+  if (moves[0] != moves[1]) {
+    printf("WARNING: the schedulers played different games\n");
+  }
+}
+
+// Benchmark the strategies: play the same seeded rounds once per strategy,
+// every bot using it, and compare how much searching each one does
+void run_strategy_bench() {
+  int rounds = Game_rounds;
+
+  printf("bench: %d rounds, %d bots, seed %u\n", rounds, Num_players, Seed);
+  printf("%-8s %8s %8s %10s %12s %12s %10s %9s\n", "strategy", "finished",
+         "retreats", "ticks", "moves", "expanded", "ms", "ns/move");
+  for (int s = 0; s < NUM_STRATEGIES; s++) {
+    long long ns = 0, moves = 0, expanded = 0, ticks = 0;
+    int finished = 0, retreats = 0;
+
+    Strategies.assign(1, s);
+    for (int r = 0; r < rounds; r++) {
+      srand(Seed + (unsigned int) r);
+      run_round();
+      ns += Solve_ns;
+      ticks += Game_moves;
+      finished += Players_finished;
+      retreats += Bot_retreats;
+      for (int p = 0; p < Num_players; p++) {
+        moves += players.moves[p];
+        expanded += players.expanded[p];
+      }
+    }
+    printf("%-8s %4d/%-3d %8d %10lld %12lld %12lld %10.2f %9.1f\n",
+           STRATEGY_NAMES[s], finished, rounds * Num_players, retreats,
+           ticks, moves, expanded, (double) ns / 1e6,
+           moves ? (double) ns / (double) moves : 0.0);
+  }
+  printf("maze %dx%d\n", Round_rows, Round_cols);
+}
+
+// Benchmark the flood fills on freshly generated 1k and 10k square mazes:
+// the bit-parallel fill against the scalar one from the top-left cell,
+// checking that both reach exactly the same cells
+void run_flood_bench() {
+  const int sizes[] = {1023, 10001};
+
+  printf("flood bench: seed %u\n", Seed);
+  printf("%-12s %10s %9s %10s %10s %8s %6s\n", "maze", "reached", "fills",
+         "bits ms", "scalar ms", "speedup", "check");
+  for (int size : sizes) {
+    // just the grid, no bots
+    maze = (Maze *)calloc(1, sizeof(Maze));
+    if (!maze) {
+      exit_game("Failed to allocate memory for maze\n");
+    }
+    maze->rows = maze->cols = size;
+    maze->grid = (Cell **)alloc_plane(size, size, sizeof(Cell));
+    if (!maze->grid) {
+      exit_game("Failed to allocate memory for maze\n");
+    }
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        maze->grid[y][x] = WALL;
+      }
+    }
+    uint64_t rng = Seed;
+    generate_maze(maze, &rng);
+
+    BitPlane open, bits, scalar;
+    load_open_bits(maze, &open);
+    long long start_ns = monotonic_ns();
+    int fills = reach_from(&open, &bits, 1, 1);
+    long long bits_ns = monotonic_ns() - start_ns;
+
+    scalar = bits;
+    std::fill(scalar.bits.begin(), scalar.bits.end(), 0);
+    scalar.bits[0 + (size_t) scalar.words] |= 2; // (1, 1)
+    start_ns = monotonic_ns();
+    flood_fill_scalar(&open, &scalar);
+    long long scalar_ns = monotonic_ns() - start_ns;
+
+    long long reached = 0;
+    for (uint64_t word : bits.bits) {
+      reached += __builtin_popcountll(word);
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "%dx%d", size, size);
+    printf("%-12s %10lld %9d %10.2f %10.2f %7.1fx %6s\n", label, reached,
+           fills, (double) bits_ns / 1e6, (double) scalar_ns / 1e6,
+           (double) scalar_ns / (double) (bits_ns > 0 ? bits_ns : 1),
+           bits.bits == scalar.bits ? "ok" : "FAILED");
+    free_maze(maze);
+    maze = NULL;
+  }
+}
+
+// Benchmark drawing: a late-round board filling a RENDER_BENCH_COLS x
+// RENDER_BENCH_ROWS terminal (trails everywhere, bots, monsters), drawn
+// RENDER_BENCH_FRAMES times in full and then RENDER_BENCH_FRAMES times
+// with RENDER_BENCH_STEP cells changed, by ncurses from each cell's UTF-8
+// text and from the glyph table, and by --ansi in 16 colours and in
+// truecolor. The terminal is a temporary file, so the bytes sent can be
+// counted. The cells are UTF-8, so the locale must be too: without one
+// ncurses would draw them as escaped bytes and time something else
+void run_render_bench() {
+  const char *labels[] = {"utf-8 text", "glyph table", "ansi 16",
+                          "ansi 24-bit"};
+  char locale[64] = "";
+  if (strcmp(nl_langinfo(CODESET), "UTF-8") != 0) {
+    snprintf(locale, sizeof(locale), "%s", setlocale(LC_CTYPE, NULL));
+    if (!setlocale(LC_CTYPE, "C.UTF-8")) {
+      exit_game("The render bench needs a UTF-8 locale, and %s isn't one "
+                "(set LANG, e.g. LANG=C.UTF-8)\n", locale);
+    }
+  }
+  FILE *out = tmpfile();
+  SCREEN *screen = out ? newterm(getenv("TERM") ? NULL : "xterm", out, stdin)
+                       : NULL;
+  if (!screen) {
+    exit_game("Can't open a terminal for the render bench\n");
+  }
+  resizeterm(RENDER_BENCH_ROWS, RENDER_BENCH_COLS);
+  getmaxyx(stdscr, Term_rows, Term_cols);
+  if (has_colors()) {
+    start_color();
+    use_default_colors();
+    init_colors();
+  }
+  Ansi_fd = fileno(out);
+  Headless = 0;
+  initialize_players(0);
+
+  // the board print_maze shows at this size, after a busy round
+  maze = create_maze(RENDER_BENCH_ROWS - 7, RENDER_BENCH_COLS - 1);
+  if (!maze) {
+    exit_game("Failed to allocate memory for maze\n");
+  }
+  uint64_t rng = Seed;
+  generate_maze(maze, &rng);
+  long long cells = 0;
+  for (int y = 0; y < maze->rows; y++) {
+    for (int x = 0; x < maze->cols; x++) {
+      if (maze->grid[y][x] != PATH) {
+        continue;
+      }
+      int roll = (int) (splitmix64(&rng) % 100);
+      int p = (int) (splitmix64(&rng) % (uint64_t) Num_players);
+      if (roll < 50) {
+        maze->grid[y][x] = (Cell) (VISITED_BASE + p);
+      } else if (roll < 60) {
+        maze->grid[y][x] = (Cell) (SOLUTION_BASE + p);
+      } else if (roll < 62) {
+        maze->grid[y][x] = MONSTER;
+      } else if (roll < 63) {
+        maze->grid[y][x] = TELEPORTER;
+      }
+    }
+  }
+  for (int p = 0; p < Num_players; p++) {
+    int x = 1 + 2 * p % (maze->cols - 2), y = 1 + 2 * p / (maze->cols - 2);
+    players.current[p].x = x;
+    players.current[p].y = y;
+    players.info[p].start = players.info[p].end = players.current[p];
+    maze->bot_at[y][x] = p + 1;
+  }
+  // the stats panel's moves left (none, the bots are on their goals)
+  build_junction_graph();
+  Node_dist.resize((size_t) Num_players * (size_t) Junctions.num_nodes);
+  parallel_for(Num_players, compute_distance_field);
+  std::vector<Cell> board;
+  for (int y = 0; y < maze->rows; y++) {
+    board.insert(board.end(), maze->grid[y], maze->grid[y] + maze->cols);
+  }
+
+  printf("render bench: %dx%d terminal, %d frames, seed %u, locale %s%s%s\n",
+         RENDER_BENCH_COLS, RENDER_BENCH_ROWS, RENDER_BENCH_FRAMES, Seed,
+         setlocale(LC_CTYPE, NULL), locale[0] ? " instead of " : "", locale);
+  printf("%-12s %10s %9s %11s %10s %11s\n", "drawing", "ms/frame",
+         "ns/cell", "bytes/frame", "step ms", "step bytes");
+  for (int mode = 0; mode < 4; mode++) {
+    Use_glyph_table = mode > 0;
+    Use_ansi = mode >= 2;
+    Ansi_truecolor = mode == 3;
+    init_ansi();
+    for (int y = 0; y < maze->rows; y++) {
+      memcpy(maze->grid[y], &board[(size_t) y * (size_t) maze->cols],
+             (size_t) maze->cols * sizeof(Cell));
+    }
+    clear();
+    invalidate_shadow();
+    print_maze(); // warm up
+    refresh();
+
+    // in full: ncurses sends every cell when told the screen is garbled
+    fflush(out);
+    long long start_bytes = (long long) lseek(Ansi_fd, 0, SEEK_END);
+    long long start_ns = monotonic_ns();
+    for (int f = 0; f < RENDER_BENCH_FRAMES; f++) {
+      invalidate_shadow();
+      clearok(curscr, !Use_ansi);
+      print_maze();
+      refresh();
+    }
+    long long ns = monotonic_ns() - start_ns;
+    fflush(out);
+    long long bytes = (long long) lseek(Ansi_fd, 0, SEEK_END) - start_bytes;
+    cells = (long long) Shadow_rows * Shadow_cols * RENDER_BENCH_FRAMES;
+
+    // a few trails growing
+    uint64_t step_rng = Seed;
+    start_bytes += bytes;
+    start_ns = monotonic_ns();
+    for (int f = 0; f < RENDER_BENCH_FRAMES; f++) {
+      for (int c = 0; c < RENDER_BENCH_STEP; c++) {
+        int y = (int) (splitmix64(&step_rng) % (uint64_t) maze->rows);
+        int x = (int) (splitmix64(&step_rng) % (uint64_t) maze->cols);
+        int p = (int) (splitmix64(&step_rng) % (uint64_t) Num_players);
+        if (maze->grid[y][x] != WALL) {
+          maze->grid[y][x] = (Cell) (VISITED_BASE + p);
+        }
+      }
+      print_maze();
+      refresh();
+    }
+    long long step_ns = monotonic_ns() - start_ns;
+    fflush(out);
+    long long step_bytes = (long long) lseek(Ansi_fd, 0, SEEK_END) - start_bytes;
+    printf("%-12s %10.3f %9.1f %11lld %10.3f %11lld\n", labels[mode],
+           (double) ns / 1e6 / RENDER_BENCH_FRAMES,
+           (double) ns / (double) (cells ? cells : 1),
+           bytes / RENDER_BENCH_FRAMES,
+           (double) step_ns / 1e6 / RENDER_BENCH_FRAMES,
+           step_bytes / RENDER_BENCH_FRAMES);
+  }
+  Use_glyph_table = 1;
+  Use_ansi = 0;
+  Ansi_fd = STDOUT_FILENO;
+  Headless = 1;
+  free_maze(maze);
+  maze = NULL;
+  endwin();
+  delscreen(screen);
+  fclose(out);
+}
+
+// Parse a comma separated --strategy list into Strategies
+int parse_strategies(const char *list) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "%s", list);
+
+  Strategies.clear();
+  for (char *name = strtok(buffer, ","); name; name = strtok(NULL, ",")) {
+    int s = 0;
+    while (s < NUM_STRATEGIES && strcmp(name, STRATEGY_NAMES[s]) != 0) {
+      s++;
+    }
+    if (s == NUM_STRATEGIES) {
+      return 0;
+    }
+    Strategies.push_back(s);
+  }
+  return !Strategies.empty();
 }
 
 void initialize_players(int stage) {
@@ -544,13 +2051,17 @@ void initialize_players(int stage) {
     ///////////////////////////////
     // Global vars
     memset(teleporters, 0, sizeof(teleporters));    
-    memset(monsters, 0, sizeof(monsters));
+    resize_monsters(0);
     Liv_monsters = 0;
-    memset(players, 0, sizeof(players));
-    memset(parent_map, 0, sizeof(parent_map));
+    // drop last round's bots, then zero fill a fresh set
+    resize_players(0);
+    resize_players(Num_players);
     Players_finished = 0;
+    Bot_retreats = 0;
     Game_finished = 0;
     Game_moves = 0;
+    Game_time = 0;
+    Fast_forward = 0;
     maze = NULL;
     // Clear all status line entries
     for (int i = 0; i < STATUS_LINE_HISTORY; i++) {
@@ -559,250 +2070,432 @@ void initialize_players(int stage) {
     }
 
     ///////////////////////////////
-    // Copy the base direction arrays to start
-    int dx_copy[4];
-    int dy_copy[4];
-    memcpy(dx_copy, Base_dx, sizeof(Base_dx));
-    memcpy(dy_copy, Base_dy, sizeof(Base_dy));
-  
-    // Initialize player 1 with default directions (Up, Right, Down, Left)
-    players[0].id = 1;
-    players[0].strength = DEF_PLAYER_STRENGTH;
-    players[0].battles_won = 0;
-    players[0].battles_lost = 0;
-    players[0].recovery_turns = 0;
-    players[0].justTeleported = 0;
-    players[0].moves = 0;
-    players[0].reached_goal = 0;
-    players[0].finished_rank = 0;
-    players[0].abandoned_race = 0;
-    players[0].visited_char = VISITED1;
-    players[0].solution_char = SOLUTION1;
-    players[0].color_pair = 2; // Red
-    // Set direction preferences - Right, Down, Left, Up (good for top-left to
-    // bottom-right)
-    players[0].dx[0] = 1; // Right
-    players[0].dy[0] = 0;
-    players[0].dx[1] = 0; // Down
-    players[0].dy[1] = 1;
-    players[0].dx[2] = -1; // Left
-    players[0].dy[2] = 0;
-    players[0].dx[3] = 0; // Up
-    players[0].dy[3] = -1;
-  
-    // Initialize player 2 with different direction preference
-    players[1].id = 2;
-    players[1].strength = DEF_PLAYER_STRENGTH;
-    players[1].battles_won = 0;
-    players[1].battles_lost = 0;
-    players[1].recovery_turns = 0;
-    players[1].justTeleported = 0;
-    players[1].moves = 0;
-    players[1].reached_goal = 0;
-    players[1].finished_rank = 0;
-    players[1].abandoned_race = 0;
-    players[1].visited_char = VISITED2;
-    players[1].solution_char = SOLUTION2;
-    players[1].color_pair = 3; // Cyan
-    // Set direction preferences - Left, Down, Right, Up (good for top-right to
-    // bottom-left)
-    players[1].dx[0] = -1; // Left
-    players[1].dy[0] = 0;
-    players[1].dx[1] = 0; // Down
-    players[1].dy[1] = 1;
-    players[1].dx[2] = 1; // Right
-    players[1].dy[2] = 0;
-    players[1].dx[3] = 0; // Up
-    players[1].dy[3] = -1;
-  
-    // Initialize player 3 with different direction preference
-    players[2].id = 3;
-    players[2].strength = DEF_PLAYER_STRENGTH;
-    players[2].battles_won = 0;
-    players[2].battles_lost = 0;
-    players[2].recovery_turns = 0;
-    players[2].justTeleported = 0;
-    players[2].moves = 0;
-    players[2].reached_goal = 0;
-    players[2].finished_rank = 0;
-    players[2].abandoned_race = 0;
-    players[2].visited_char = VISITED3;
-    players[2].solution_char = SOLUTION3;
-    players[2].color_pair = 4; // Yellow
-    // Set direction preferences - Right, Up, Left, Down (good for bottom-left to
-    // top-right)
-    players[2].dx[0] = 1; // Right
-    players[2].dy[0] = 0;
-    players[2].dx[1] = 0; // Up
-    players[2].dy[1] = -1;
-    players[2].dx[2] = -1; // Left
-    players[2].dy[2] = 0;
-    players[2].dx[3] = 0; // Down
-    players[2].dy[3] = 1;
-  
-    // Initialize player 4 with different direction preference
-    players[3].id = 4;
-    players[3].strength = DEF_PLAYER_STRENGTH;
-    players[3].battles_won = 0;
-    players[3].battles_lost = 0;
-    players[3].recovery_turns = 0;
-    players[3].justTeleported = 0;
-    players[3].moves = 0;
-    players[3].reached_goal = 0;
-    players[3].finished_rank = 0;
-    players[3].abandoned_race = 0;
-    players[3].visited_char = VISITED4;
-    players[3].solution_char = SOLUTION4;
-    players[3].color_pair = 5; // Green
-    // Set direction preferences - Left, Up, Right, Down (good for bottom-right to
-    // top-left)
-    players[3].dx[0] = -1; // Left
-    players[3].dy[0] = 0;
-    players[3].dx[1] = 0; // Up
-    players[3].dy[1] = -1;
-    players[3].dx[2] = 1; // Right
-    players[3].dy[2] = 0;
-    players[3].dx[3] = 0; // Down
-    players[3].dy[3] = 1;
-  
-    // Now randomize each player's directions slightly for variety
-    for (int i = 0; i < NUM_PLAYERS; i++) {
-      shuffle_directions_for_player(i);
+    // Per-bot defaults; positions and directions are set in stage 1
+    for (int i = 0; i < Num_players; i++) {
+      players.info[i].id = i + 1;
+      players.strength[i] = DEF_PLAYER_STRENGTH;
+      players.battles_won[i] = 0;
+      players.battles_lost[i] = 0;
+      players.recovery_until[i] = 0;
+      players.teleport_until[i] = 0;
+      players.period[i] = entity_period(BOT_PERIOD);
+      players.moves[i] = 0;
+      players.expanded[i] = 0;
+      players.info[i].strategy =
+          Strategies.empty() ? STRAT_DFS
+                             : Strategies[(size_t) i % Strategies.size()];
+      players.reached_goal[i] = 0;
+      players.finished_rank[i] = 0;
+      players.abandoned_race[i] = 0;
+      players.next_at[i] = 0;
+      players.info[i].visited_char = get_player_visited_char(i + 1);
+      players.info[i].solution_char = get_player_solution_char(i + 1);
+      players.info[i].color_pair = bot_color_pair(i);
+      make_bot_names(i, players.info[i].name, players.info[i].long_name);
+      make_bot_glyphs(i, players.info[i].current_glyph, players.info[i].end_glyph);
+    }
+    if (!Headless) {
+      build_glyphs();
     }
   // Stage 1
   } else {
-    shuffleArray(MONSTER_NAMES, MONSTER_NAMES_R, 26);
+    shuffleArray(MONSTER_NAMES, MONSTER_NAMES_R, NUM_MONSTER_NAMES);
     if(maze->cols < MIN_COLS + 10 ) {
-      memcpy(BOT_NAMES_F, BOT_NAMES, sizeof(BOT_NAMES_F));
-      strcpy(Stats_header, "  NAME | ST | BATS  | MOVES | STATUS");
+      Long_names = 0;
+      strcpy(Stats_header, "  NAME | ST | BATS  | MOVES |  LEFT | ~WIN | STATUS");
     } else {
-      memcpy(BOT_NAMES_F, BOT_NAMES_LONG, sizeof(BOT_NAMES_F));
-      strcpy(Stats_header, "  NAME          | ST | BATS  | MOVES | STATUS");
-    }
-    // Set player start and end positions to corners
-    players[0].start.x = 1;
-    players[0].start.y = 1;
-    players[0].end.x = maze->cols - 2;
-    players[0].end.y = maze->rows - 2;
-    maze->grid[players[0].end.y][players[0].end.x]     = END1;
-  
-    players[1].start.x = maze->cols - 2;
-    players[1].start.y = 1;
-    players[1].end.x = 1;
-    players[1].end.y = maze->rows - 2;
-    maze->grid[players[1].end.y][players[1].end.x]     = END2;
-  
-    players[2].start.x = 1;
-    players[2].start.y = maze->rows - 2;
-    players[2].end.x = maze->cols - 2;
-    players[2].end.y = 1;
-    maze->grid[players[2].end.y][players[2].end.x]     = END3;
-  
-    players[3].start.x = maze->cols - 2;
-    players[3].start.y = maze->rows - 2;
-    players[3].end.x = 1;
-    players[3].end.y = 1;
-    maze->grid[players[3].end.y][players[3].end.x]     = END4;
-  
-    // Initialize player current positions
-    for (int i = 0; i < NUM_PLAYERS; i++) {
-      players[i].current = players[i].start;
+      Long_names = 1;
+      strcpy(Stats_header, "  NAME          | ST | BATS  | MOVES |  LEFT | ~WIN | STATUS");
+    }
+    for (int i = 0; i < Num_players; i++) {
+      // Set player start and end positions
+      assign_start_goal(maze, i, &players.info[i].start, &players.info[i].end);
+      maze->grid[players.info[i].end.y][players.info[i].end.x] = (Cell) (END_BASE + i);
+
+      // Set direction preferences - toward the goal first, e.g. Right, Down,
+      // Left, Up for top-left to bottom-right
+      int hx = players.info[i].end.x < players.info[i].start.x ? -1 : 1;
+      int vy = players.info[i].end.y < players.info[i].start.y ? -1 : 1;
+      players.info[i].dx[0] = hx; // Horizontal toward goal
+      players.info[i].dy[0] = 0;
+      players.info[i].dx[1] = 0;  // Vertical toward goal
+      players.info[i].dy[1] = vy;
+      players.info[i].dx[2] = -hx; // Horizontal away from goal
+      players.info[i].dy[2] = 0;
+      players.info[i].dx[3] = 0;   // Vertical away from goal
+      players.info[i].dy[3] = -vy;
+
+      // Now randomize the directions slightly for variety
+      shuffle_directions_for_player(i);
+
+      // Initialize player current position
+      players.current[i] = players.info[i].start;
+      add_bot_at(i);
     }
   }
 }
 
-// Shuffle the directions for a specific player
-void shuffle_directions_for_player(int idx) {
-  // Apply a Fisher-Yates shuffle but only to the last 2 directions
-  // This preserves the main direction preference but adds some randomness
-  for (int i = 3; i >= 2; i--) {
-    int j = rand() % (i + 1);
+// Resize every field of the bot store; new entries are zero filled
+void resize_players(int n) {
+  players.current.resize(n);
+  players.recovery_until.resize(n);
+  players.teleport_until.resize(n);
+  players.period.resize(n);
+  players.reached_goal.resize(n);
+  players.abandoned_race.resize(n);
+  players.moves.resize(n);
+  players.expanded.resize(n);
+  players.optimal.resize(n);
+  players.next_at.resize(n);
+  players.strength.resize(n);
+  players.battles_won.resize(n);
+  players.battles_lost.resize(n);
+  players.finished_rank.resize(n);
+  players.info.resize(n);
+}
 
-    // Swap dx[i] with dx[j]
-    int temp = players[idx].dx[i];
-    players[idx].dx[i] = players[idx].dx[j];
-    players[idx].dx[j] = temp;
+// Resize every field of the monster store; new entries are zero filled
+void resize_monsters(int n) {
+  monsters.x.resize(n);
+  monsters.y.resize(n);
+  monsters.dx.resize(n);
+  monsters.dy.resize(n);
+  monsters.patrol_length.resize(n);
+  monsters.steps.resize(n);
+  monsters.strength.resize(n);
+  monsters.defeated.resize(n);
+  monsters.recovery_until.resize(n);
+  monsters.period.resize(n);
+  monsters.next_at.resize(n);
+  monsters.under.resize(n);
+  monsters.info.resize(n);
+}
+
+// Pick the start and goal for a bot: the first four race corner to opposite
+// corner, the rest are spread evenly around the border and race to the
+// mirrored cell on the other side
+void assign_start_goal(const Maze *m, int idx, Position *start, Position *end) {
+  int right  = m->cols - 2;
+  int bottom = m->rows - 2;
+  // top-left, top-right, bottom-left, bottom-right
+  const int corner_x[] = {1, right, 1, right};
+  const int corner_y[] = {1, 1, bottom, bottom};
+  int x, y;
+
+  if (idx < 4) {
+    x = corner_x[idx];
+    y = corner_y[idx];
+  } else {
+    // Walk the ring of border cells (odd coordinates) clockwise from top-left
+    int w = (right - 1) / 2;  // steps along the top edge
+    int h = (bottom - 1) / 2; // steps along the right edge
+    int ring = 2 * (w + h);
+    int extra = Num_players - 4;
+    int t = (int) (((2L * (idx - 4) + 1) * ring) / (2L * extra));
+    if (t < w) {
+      x = 1 + 2 * t;              y = 1;
+    } else if (t < w + h) {
+      x = right;                  y = 1 + 2 * (t - w);
+    } else if (t < 2 * w + h) {
+      x = right - 2 * (t - w - h); y = bottom;
+    } else {
+      x = 1;                      y = bottom - 2 * (t - 2 * w - h);
+    }
+  }
+  start->x = x;
+  start->y = y;
+  start->parentX = -1;
+  start->parentY = -1;
+  end->x = m->cols - 1 - x;
+  end->y = m->rows - 1 - y;
+  end->parentX = -1;
+  end->parentY = -1;
+}
+
+// Build a bot's short and long names; the first four are the classic
+// Fruitbots, the rest are assembled from BOT_ADJECTIVES and BOT_FRUITS
+void make_bot_names(int idx, char *name, char *long_name) {
+  if (idx < 4) {
+    strcpy(name, BOT_NAMES[idx + 1]);
+    strcpy(long_name, BOT_NAMES_LONG[idx + 1]);
+    return;
+  }
+  int n_adj   = sizeof(BOT_ADJECTIVES) / sizeof(BOT_ADJECTIVES[0]);
+  int n_fruit = sizeof(BOT_FRUITS) / sizeof(BOT_FRUITS[0]);
+  const char *adj   = BOT_ADJECTIVES[(idx - 4) % n_adj];
+  // pair the nth adjective with the nth fruit first, for alliteration
+  const char *fruit = BOT_FRUITS[((idx - 4) % n_adj + (idx - 4) / n_adj) % n_fruit];
+  char full[32];
+  snprintf(name, 8, "%.3s%.3s", adj, fruit);
+  snprintf(full, sizeof(full), "%s %s", adj, fruit);
+  snprintf(long_name, 16, "%-15.15s", full);
+}
+
+// Encode a code point as UTF-8
+static void utf8_encode(unsigned int cp, char *out) {
+  if (cp < 0x80) {
+    *out++ = (char) cp;
+  } else if (cp < 0x800) {
+    *out++ = (char) (0xC0 | (cp >> 6));
+    *out++ = (char) (0x80 | (cp & 0x3F));
+  } else {
+    *out++ = (char) (0xE0 | (cp >> 12));
+    *out++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+    *out++ = (char) (0x80 | (cp & 0x3F));
+  }
+  *out = '\0';
+}
+
+// Build a bot's position glyph (①-⑳, then Ⓐ-Ⓩ, ⓐ-ⓩ, then SWARM_CHAR) and
+// goal glyph (first letter of the fruit)
+void make_bot_glyphs(int idx, char *current_glyph, char *end_glyph) {
+  if (idx < 20) {
+    utf8_encode(0x2460 + (unsigned int) idx, current_glyph);
+  } else if (idx < 72) {
+    utf8_encode(0x24B6 + (unsigned int) (idx - 20), current_glyph);
+  } else {
+    strcpy(current_glyph, SWARM_CHAR);
+  }
+  char name[8], long_name[16];
+  make_bot_names(idx, name, long_name);
+  // long names are space padded, so skip back over the padding first
+  int i = (int) strlen(long_name);
+  while (i > 0 && long_name[i - 1] == ' ') i--;
+  while (i > 0 && long_name[i - 1] != ' ') i--;
+  end_glyph[0] = long_name[i];
+  end_glyph[1] = '\0';
+}
+
+// Colour pair for a bot index, also valid for ids from older high scores
+int bot_color_pair(int idx) {
+  int n = sizeof(BOT_COLOR_PAIRS) / sizeof(BOT_COLOR_PAIRS[0]);
+  return BOT_COLOR_PAIRS[(idx < 0 ? 0 : idx) % n];
+}
+
+// Long name for a bot id, including ids from older high score files
+const char *bot_long_name(int player_id) {
+  static char name[8], long_name[16];
+  make_bot_names(player_id < 1 ? 0 : player_id - 1, name, long_name);
+  return long_name;
+}
+
+// Name of a bot sized for the stats panel
+const char *bot_name(int idx) {
+  return Long_names ? players.info[idx].long_name : players.info[idx].name;
+}
+
+// "st", "nd", "rd" or "th" for a finishing rank
+const char *rank_suffix(int rank) {
+  if (rank % 100 >= 11 && rank % 100 <= 13) return "th";
+  switch (rank % 10) {
+  case 1: return "st";
+  case 2: return "nd";
+  case 3: return "rd";
+  default: return "th";
+  }
+}
+
+// Shuffle the directions for a specific player
+void shuffle_directions_for_player(int idx) {
+  // Apply a Fisher-Yates shuffle but only to the last 2 directions
+  // This preserves the main direction preference but adds some randomness
+  for (int i = 3; i >= 2; i--) {
+    int j = rand() % (i + 1);
+
+    // Swap dx[i] with dx[j]
+    int temp = players.info[idx].dx[i];
+    players.info[idx].dx[i] = players.info[idx].dx[j];
+    players.info[idx].dx[j] = temp;
 
     // Swap dy[i] with dy[j]
-    temp = players[idx].dy[i];
-    players[idx].dy[i] = players[idx].dy[j];
-    players[idx].dy[j] = temp;
+    temp = players.info[idx].dy[i];
+    players.info[idx].dy[i] = players.info[idx].dy[j];
+    players.info[idx].dy[j] = temp;
   }
 }
 
 // Helper function to get the current character for a player
-char get_player_current_char(int player_id) {
-  switch (player_id) {
-  case 1:
-    return CURRENT1;
-  case 2:
-    return CURRENT2;
-  case 3:
-    return CURRENT3;
-  case 4:
-    return CURRENT4;
-  default:
-    return '!';
-  }
+Cell get_player_current_char(int player_id) {
+  return (Cell) (CURRENT_BASE + player_id - 1);
 }
 
 // Helper function to get the visited character for a player
-char get_player_visited_char(int player_id) {
-  switch (player_id) {
-  case 1:
-    return VISITED1;
-  case 2:
-    return VISITED2;
-  case 3:
-    return VISITED3;
-  case 4:
-    return VISITED4;
-  default:
-    return '!';
-  }
+Cell get_player_visited_char(int player_id) {
+  return (Cell) (VISITED_BASE + player_id - 1);
 }
 
 // Helper function to get the solution character for a player
-char get_player_solution_char(int player_id) {
-  switch (player_id) {
-  case 1:
-    return SOLUTION1;
-  case 2:
-    return SOLUTION2;
-  case 3:
-    return SOLUTION3;
-  case 4:
-    return SOLUTION4;
-  default:
-    return '!';
+Cell get_player_solution_char(int player_id) {
+  return (Cell) (SOLUTION_BASE + player_id - 1);
+}
+
+// Check if a cell is any player's goal
+__attribute__((no_instrument_function))
+int is_end_cell(Cell c) {
+  return CELL_KIND(c) == END_BASE;
+}
+
+// Lowest index+1 of the bots in a cell, 0 if none
+__attribute__((no_instrument_function))
+int first_player_at(int x, int y) {
+  int first = 0;
+  for (int b = maze->bot_at[y][x]; b; b = players.next_at[b - 1]) {
+    if (!first || b < first) first = b;
+  }
+  return first; // Return player id (1-based)
+}
+
+// Change a cell of the board during the race, noting it in the rewind log
+__attribute__((no_instrument_function))
+static inline void set_cell(int x, int y, Cell c) {
+  if (Hash_file) {
+    uint64_t index = (uint64_t) y * (uint64_t) maze->cols + (uint64_t) x;
+    State_hash ^= hash_mix(index, maze->grid[y][x]) ^ hash_mix(index, c);
+  }
+  maze->grid[y][x] = c;
+  if (Rewind_on) {
+    Rewind.back().cells.push_back(
+        CellChange{(uint32_t) (y * maze->cols + x), c});
+  }
+}
+
+// Occupancy list maintenance: every bot/monster is linked into the list of
+// the cell it stands on, so "who is here" is O(1) instead of O(entities)
+void add_bot_at(int p) {
+  int *head = &maze->bot_at[players.current[p].y][players.current[p].x];
+  players.next_at[p] = *head;
+  *head = p + 1;
+}
+
+void remove_bot_at(int p) {
+  int *link = &maze->bot_at[players.current[p].y][players.current[p].x];
+  while (*link && *link != p + 1) {
+    link = &players.next_at[*link - 1];
+  }
+  if (*link) *link = players.next_at[p];
+  players.next_at[p] = 0;
+}
+
+// Direction index of a one cell step, -1 for anything longer
+static int step_direction(int dx, int dy) {
+  for (int dir = 0; dir < 4; dir++) {
+    if (Base_dx[dir] == dx && Base_dy[dir] == dy) {
+      return dir;
+    }
+  }
+  return -1;
+}
+
+void move_bot(int p, Position pos) {
+  int dir = step_direction(pos.x - players.current[p].x,
+                           pos.y - players.current[p].y);
+  if (dir >= 0) {
+    record_event((uint64_t) p << 3 | (uint64_t) dir);
+  } else {
+    record_event((uint64_t) p << 3 | EV_JUMP);
+    record_event((uint64_t) pos.x);
+    record_event((uint64_t) pos.y);
+  }
+  remove_bot_at(p);
+  players.current[p] = pos;
+  add_bot_at(p);
+}
+
+void add_monster_at(int m) {
+  int *head = &maze->monster_at[monsters.y[m]][monsters.x[m]];
+  monsters.next_at[m] = *head;
+  *head = m + 1;
+}
+
+void remove_monster_at(int m) {
+  int *link = &maze->monster_at[monsters.y[m]][monsters.x[m]];
+  while (*link && *link != m + 1) {
+    link = &monsters.next_at[*link - 1];
+  }
+  if (*link) *link = monsters.next_at[m];
+  monsters.next_at[m] = 0;
+}
+
+void move_monster(int m, int x, int y) {
+  remove_monster_at(m);
+  monsters.x[m] = x;
+  monsters.y[m] = y;
+  add_monster_at(m);
+}
+
+// Step (x, y) back to where bot p came from, returns 0 if it has no parent
+__attribute__((no_instrument_function))
+int trail_parent(int p, int *x, int *y) {
+  char trail = trail_at(p, *x, *y);
+  if (trail >= TRAIL_DIR && trail < TRAIL_TELEPORT) {
+    *x += Base_dx[trail - TRAIL_DIR];
+    *y += Base_dy[trail - TRAIL_DIR];
+    return 1;
   }
+  if (trail == TRAIL_TELEPORT) {
+    return check_teleporter(*x, *y, x, y);
+  }
+  return 0;
 }
 
-// Check if a position is a player's position
+// Record that bot p reached (x, y) from (px, py)
 __attribute__((no_instrument_function))
-int is_player_position(int x, int y, Position *current_pos) {
-  for (int i = 0; i < NUM_PLAYERS; i++) {
-    if (current_pos[i].x == x && current_pos[i].y == y) {
-      return i + 1; // Return player id (1-based)
+void set_trail(int p, int x, int y, int px, int py) {
+  char trail = TRAIL_TELEPORT;
+  for (int dir = 0; dir < 4; dir++) {
+    if (x + Base_dx[dir] == px && y + Base_dy[dir] == py) {
+      trail = (char) (TRAIL_DIR + dir);
+      break;
     }
   }
-  return 0; // Not a player position
+  put_trail(p, x, y, trail);
+}
+
+// Set bot p's trail value of a cell, keeping its marks; the trail's share
+// of the state hash is kept per bot, as trails are written in the propose
+// phase
+__attribute__((no_instrument_function)) static inline
+void put_trail(int p, int x, int y, char trail) {
+  if (Hash_file) {
+    uint64_t index = ((uint64_t) p << 40) + (uint64_t) y * (uint64_t) maze->cols +
+                     (uint64_t) x;
+    uint64_t old = (uint64_t) trail_at(p, x, y);
+    Trail_hash[p] ^= (old ? hash_mix(index, old) : 0) ^
+                     (trail ? hash_mix(index, (uint64_t) trail) : 0);
+  }
+  maze->visited[p][y][x] = (char) ((maze->visited[p][y][x] & ~TRAIL_BITS) | trail);
+}
+
+// Bot p's trail value of a cell, TRAIL_NONE if it hasn't been there
+__attribute__((no_instrument_function)) static inline
+char trail_at(int p, int x, int y) {
+  return (char) (maze->visited[p][y][x] & TRAIL_BITS);
+}
+
+// The strategy marks bot p keeps on a cell, in the spare bits of its trail
+// plane so no strategy needs a plane of its own. They aren't part of the
+// state hash: they follow from the moves
+__attribute__((no_instrument_function)) static inline
+int marks_at(int p, int x, int y) {
+  return (unsigned char) maze->visited[p][y][x] >> MARK_SHIFT;
+}
+
+__attribute__((no_instrument_function)) static inline
+void put_marks(int p, int x, int y, int marks) {
+  maze->visited[p][y][x] = (char) ((maze->visited[p][y][x] & TRAIL_BITS) |
+                                   (marks << MARK_SHIFT));
 }
 
 // Check if a position is a dead end
 __attribute__((no_instrument_function))
-int is_dead_end(int x, int y) {
+int is_dead_end(const Maze *m, int x, int y) {
   // Don't consider special positions as dead ends
-  if (
-      maze->grid[y][x] == END1 || 
-      maze->grid[y][x] == END2 ||
-      maze->grid[y][x] == END3 || 
-      maze->grid[y][x] == END4) {
+  if (is_end_cell(m->grid[y][x])) {
     return 0;
   }
 
   // Only check PATH cells
-  if (maze->grid[y][x] != PATH) {
+  if (m->grid[y][x] != PATH) {
     return 0;
   }
 
@@ -812,13 +2505,9 @@ int is_dead_end(int x, int y) {
     int newX = x + Base_dx[dir];
     int newY = y + Base_dy[dir];
 
-    if (newX >= 0 && newX < maze->cols && newY >= 0 && newY < maze->rows) {
-      char cell = maze->grid[newY][newX];
-      if (cell == PATH || 
-          cell == END1 || 
-          cell == END2 || 
-          cell == END3 ||
-          cell == END4) {
+    if (newX >= 0 && newX < m->cols && newY >= 0 && newY < m->rows) {
+      Cell cell = m->grid[newY][newX];
+      if (cell == PATH || is_end_cell(cell)) {
         path_neighbors++;
       }
     }
@@ -828,50 +2517,343 @@ int is_dead_end(int x, int y) {
   return (path_neighbors == 1);
 }
 
+//////////////////////////////////////////////////////
+// Win estimates. The live engine can't be copied mid-round (the bot
+// controllers are coroutine frames), so these are not rollouts of the
+// game: Win_thread samples a model of the race instead, in which each
+// racing bot's remaining moves to its goal are a random walk with the
+// drift it has shown so far, and the battles it meets on the way may knock
+// it out. The stats panel labels them ~WIN. The main thread only posts a
+// copy of the model's inputs every few ticks and never waits
+
+// Copy what the estimator needs of the bots and hand it to Win_thread,
+// unless nothing has happened since the last post. Never blocks: if the
+// worker is taking the last copy just now, try again next time
+void post_win_estimate() {
+  if (Headless || Fast_forward || !maze) {
+    return;
+  }
+  if (Win_tick >= 0 && Game_moves >= Win_tick &&
+      Game_moves < Win_tick + WIN_REFRESH_TICKS &&
+      Players_finished == Win_finished) {
+    return;
+  }
+  if (!Win_lock.try_lock()) {
+    return;
+  }
+  if (!Win_thread.joinable()) {
+    Win_thread = std::thread(win_worker);
+  }
+  // the average live monster, and what a battle with it is worth
+  long long strength = 0;
+  int live = 0;
+  for (int m = 0; m < Num_monsters; m++) {
+    if (!monsters.defeated[m]) {
+      strength += monsters.strength[m];
+      live++;
+    }
+  }
+  int monster = live ? (int) (strength / live) : 0;
+
+  Win_input.resize((size_t) Num_players);
+  for (int p = 0; p < Num_players; p++) {
+    WinBot &b = Win_input[(size_t) p];
+    int left = goal_moves(p, players.current[p].x, players.current[p].y);
+    int progress = players.optimal[p] - left;
+    int losses = 0;
+    for (int d1 = 1; d1 <= 6; d1++) {
+      for (int d2 = 1; d2 <= 6; d2++) {
+        losses += players.strength[p] + d1 < monster + d2; // bots win ties
+      }
+    }
+    b.racing = !players.reached_goal[p] && !players.abandoned_race[p] &&
+               left >= 0;
+    b.finished_rank = players.reached_goal[p] ? players.finished_rank[p] : 0;
+    b.left = left;
+    b.period = players.period[p];
+    b.lives = 3 - players.battles_lost[p];
+    // a start of 40 moves at 0.3 keeps the first few ticks sensible
+    b.efficiency = ((double) progress + 12.0) / ((double) players.moves[p] + 40.0);
+    b.efficiency = b.efficiency < 0.02 ? 0.02 : MIN(b.efficiency, 0.99);
+    b.battle_rate = (double) (players.battles_won[p] + players.battles_lost[p]) /
+                    ((double) players.moves[p] + 20.0);
+    b.lose_chance = live ? losses / 36.0 : 0.0;
+  }
+  Win_input_round = Rounds_started;
+  Win_posted = 1;
+  Win_tick = Game_moves;
+  Win_finished = Players_finished;
+  Win_lock.unlock();
+  Win_wake.notify_one();
+}
+
+// Uniform in (0, 1], from the estimator's own generator so the game's
+// rand() is never touched
+static inline double win_uniform(uint64_t *rng) {
+  return ((double) (splitmix64(rng) >> 11) + 1.0) / 9007199254740992.0;
+}
+
+static inline double win_normal(uint64_t *rng) {
+  return sqrt(-2.0 * log(win_uniform(rng))) * cos(2.0 * M_PI * win_uniform(rng));
+}
+
+// Moves a random walk with drift e needs to cover `left': inverse Gaussian
+// with mean left / e and shape left^2 / (WIN_SPREAD * (1 - e^2)), sampled as
+// Michael, Schucany and Haas do. Solvers back out of dead ends in runs, not
+// single steps, hence the spread
+static double win_moves(int left, double e, uint64_t *rng) {
+  double mu = left / e;
+  double lambda = (double) left * left / (WIN_SPREAD * (1.0 - e * e));
+  double y = win_normal(rng);
+  y *= y;
+  double x = mu + mu * mu * y / (2.0 * lambda) -
+             mu / (2.0 * lambda) * sqrt(4.0 * mu * lambda * y + mu * mu * y * y);
+  return win_uniform(rng) <= mu / (mu + x) ? x : mu * mu / x;
+}
+
+// Battles lost in `moves' moves: Poisson, normal when the mean is large
+static int win_losses(double mean, uint64_t *rng) {
+  if (mean > 30.0) {
+    double k = mean + sqrt(mean) * win_normal(rng);
+    return k < 0 ? 0 : (int) k;
+  }
+  double limit = exp(-mean), product = win_uniform(rng);
+  int k = 0;
+  while (product > limit) {
+    product *= win_uniform(rng);
+    k++;
+  }
+  return k;
+}
+
+// Sample the model race WIN_SAMPLES times from bots and count each bot's
+// wins, per mille. A bot that has finished first has won
+void estimate_wins(const std::vector<WinBot> &bots, uint64_t *rng,
+                   int *permille) {
+  int n = (int) bots.size();
+  std::vector<int> wins((size_t) n, 0);
+
+  for (int p = 0; p < n; p++) {
+    if (bots[(size_t) p].finished_rank == 1) {
+      for (int q = 0; q < n; q++) {
+        permille[q] = q == p ? 1000 : 0;
+      }
+      return;
+    }
+  }
+  for (int r = 0; r < WIN_SAMPLES; r++) {
+    int winner = -1;
+    double best = 0.0;
+    for (int p = 0; p < n; p++) {
+      const WinBot &b = bots[(size_t) p];
+      if (!b.racing) {
+        continue;
+      }
+      double moves = b.left > 0 ? win_moves(b.left, b.efficiency, rng) : 0.0;
+      if (b.lose_chance > 0.0 &&
+          win_losses(moves * b.battle_rate * b.lose_chance, rng) >= b.lives) {
+        continue; // knocked out on the way
+      }
+      double time = moves * b.period;
+      if (winner < 0 || time < best) {
+        winner = p;
+        best = time;
+      }
+    }
+    if (winner >= 0) {
+      wins[(size_t) winner]++;
+    }
+  }
+  for (int p = 0; p < n; p++) {
+    permille[p] = (int) ((long long) wins[(size_t) p] * 1000 / WIN_SAMPLES);
+  }
+}
+
+// Win_thread: estimate from each posted copy in turn
+void win_worker() {
+  std::vector<WinBot> bots;
+  std::vector<int> permille;
+  uint64_t rng = Seed;
+
+  for (;;) {
+    int round;
+    {
+      std::unique_lock<std::mutex> lock(Win_lock);
+      Win_wake.wait(lock, [] { return Win_posted || Win_quit; });
+      if (Win_quit) {
+        return;
+      }
+      bots = Win_input;
+      round = Win_input_round;
+      Win_posted = 0;
+    }
+    permille.resize(bots.size());
+    estimate_wins(bots, &rng, permille.data());
+    for (size_t p = 0; p < bots.size(); p++) {
+      Win_permille[p].store(permille[p], std::memory_order_relaxed);
+    }
+    Win_round.store(round);
+  }
+}
+
+void stop_win_thread() {
+  if (!Win_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(Win_lock);
+    Win_quit = 1;
+  }
+  Win_wake.notify_all();
+  Win_thread.join();
+}
+
 // Display player stats with combined battles column and status column
 void display_player_stats() {
-  int base_row = maze->rows + 1;
+  if (Headless || Fast_forward)
+    return;
+  static BoardFrame now;
+  CursesLock lock;
+  compose_stats(&now);
+  draw_stats(&now);
+  if (Use_ansi) {
+    ansi_flush();
+  }
+}
 
-  mvwprintw(stdscr, base_row - 1, 0, "%s", Stats_header);
-  wclrtoeol(stdscr);
-  for (int i = 0; i < NUM_PLAYERS; i++) {
-    attron(COLOR_PAIR(players[i].color_pair) | A_BOLD);
-    mvwprintw(stdscr, base_row + i, 0, "%6s | %2d | %2d/%-2d |  %4d | ",
-             BOT_NAMES_F[players[i].id], players[i].strength,
-             players[i].battles_won, players[i].battles_lost, players[i].moves);
+// Compose the stats panel of a frame: a row per bot shown, and a summary
+// when they don't all fit
+void compose_stats(BoardFrame *f) {
+  int shown[STATS_ROWS];
+  int num_shown = 0;
+  // the live bots, or the recorded tick shown while rewinding
+  static std::vector<BotView> live;
+  const BotView *view = Rewind_bots.data();
+  int tick = Rewind_tick;
+  if (Rewind_at < 0) {
+    post_win_estimate();
+    live.resize((size_t) Num_players);
+    for (int p = 0; p < Num_players; p++) {
+      bot_view(p, &live[(size_t) p]);
+    }
+    view = live.data();
+    tick = Game_moves;
+  }
+
+  f->stats_row = View_rows;
+  snprintf(f->header, sizeof(f->header), "%s", Stats_header);
+  if (Num_players <= STATS_ROWS) {
+    for (int i = 0; i < Num_players; i++) {
+      shown[num_shown++] = i;
+    }
+  } else {
+    // Too many bots for the panel: show the finishers by rank, then the
+    // bots still solving, then the DNFs, and summarise on the last row
+    int slots = STATS_ROWS - 1;
+    for (int i = 0; i < slots; i++) {
+      shown[i] = -1;
+    }
+    for (int i = 0; i < Num_players; i++) {
+      if (view[i].reached_goal && view[i].finished_rank <= slots) {
+        shown[view[i].finished_rank - 1] = i;
+      }
+    }
+    while (num_shown < slots && shown[num_shown] >= 0) {
+      num_shown++;
+    }
+    for (int pass = 0; pass < 2 && num_shown < slots; pass++) {
+      for (int i = 0; i < Num_players && num_shown < slots; i++) {
+        int dnf = view[i].abandoned_race != 0;
+        if (!view[i].reached_goal && dnf == pass) {
+          shown[num_shown++] = i;
+        }
+      }
+    }
+  }
+  for (int row = 0; row < num_shown; row++) {
+    int i = shown[row];
+    char *line = f->lines[row];
+    size_t size = sizeof(f->lines[row]);
+    int len = snprintf(line, size, "%6s | %2d | %2d/%-2d |  %4d | ",
+                       bot_name(i), view[i].strength, view[i].battles_won,
+                       view[i].battles_lost, view[i].moves);
+    f->line_attrs[row] = COLOR_PAIR(players.info[i].color_pair) | A_BOLD;
+
+    // Exact moves still to go from where the bot stands
+    int left = goal_moves(i, view[i].x, view[i].y);
+    if (left >= 0) {
+      len += snprintf(line + len, size - (size_t) len, "%5d | ", left);
+    } else {
+      len += snprintf(line + len, size - (size_t) len, "    - | ");
+    }
+
+    // Estimated chance to win, for the live board only
+    int permille = Win_permille[i].load(std::memory_order_relaxed);
+    if (Rewind_at < 0 && Win_round.load() == Rounds_started && permille >= 0) {
+      len += snprintf(line + len, size - (size_t) len, "%3d%% | ",
+                      (permille + 5) / 10);
+    } else {
+      len += snprintf(line + len, size - (size_t) len, "   - | ");
+    }
 
     // Add status column showing player's solve status
-    if (players[i].reached_goal) {
-            char rankn[4];
-            switch (players[i].finished_rank) {
-              case 1: strcpy(rankn, "1st"); break;
-              case 2: strcpy(rankn, "2nd"); break;
-              case 3: strcpy(rankn, "3rd"); break;
-              case 4: strcpy(rankn, "4th"); break;
-            }
-            wprintw(stdscr, "Finished %s!", rankn);
-    } else if (players[i].abandoned_race == 1) {
-      wprintw(stdscr, "DNF: Trapped");
-    } else if (players[i].abandoned_race == 2) {
-      wprintw(stdscr, "DNF: Loser");
-    } else if (Game_moves == 0) {
-      wprintw(stdscr, "Ready To Start");
+    if (view[i].reached_goal) {
+      snprintf(line + len, size - (size_t) len, "Finished %d%s! %.2fx",
+               view[i].finished_rank, rank_suffix(view[i].finished_rank),
+               (double) view[i].moves / (double) players.optimal[i]);
+    } else if (view[i].abandoned_race == 1) {
+      snprintf(line + len, size - (size_t) len, "DNF: Trapped");
+    } else if (view[i].abandoned_race == 2) {
+      snprintf(line + len, size - (size_t) len, "DNF: Loser");
+    } else if (tick == 0) {
+      snprintf(line + len, size - (size_t) len, "Ready To Start");
     } else {
-      wprintw(stdscr, "Solving");
+      snprintf(line + len, size - (size_t) len, "Solving");
     }
-    wclrtoeol(stdscr);
+  }
+  if (Num_players > STATS_ROWS) {
+    int dnf = 0, finished = 0;
+    for (int i = 0; i < Num_players; i++) {
+      dnf += view[i].abandoned_race != 0;
+      finished += view[i].reached_goal != 0;
+    }
+    snprintf(f->lines[num_shown], sizeof(f->lines[num_shown]),
+             "  %d bots: %d finished, %d DNF, %d solving", Num_players,
+             finished, dnf, Num_players - finished - dnf);
+    f->line_attrs[num_shown++] = A_BOLD;
+  }
+  f->num_lines = num_shown;
+}
 
-    attroff(COLOR_PAIR(players[i].color_pair) | A_BOLD);
+// Draw the stats panel of a frame. Holds Curses_lock
+void draw_stats(const BoardFrame *f) {
+  take_stale_rows();
+  if (Use_ansi) {
+    ansi_draw_stats(f);
+    return;
+  }
+  mvwprintw(stdscr, f->stats_row, 0, "%s", f->header);
+  wclrtoeol(stdscr);
+  for (int row = 0; row < f->num_lines; row++) {
+    attron(f->line_attrs[row]);
+    mvwprintw(stdscr, f->stats_row + 1 + row, 0, "%s", f->lines[row]);
+    wclrtoeol(stdscr);
+    attroff(f->line_attrs[row]);
   }
   wnoutrefresh(stdscr);
 }
 
 // Display player alert with variable parameters
 //                     player_index  -2=abandoned, -1=out of moves, >0 is rank
+// Like present_battle() it pauses the game, so it waits for Curses_lock
+// once and holds it to the end rather than skipping parts
 void display_player_alert(int p_idx, int rank) {
   Game_finished++;
+  if (Headless || Fast_forward)
+    return;
+  CursesLock lock;
   if (ShowWindows == 0) {
-    if(Game_finished != NUM_PLAYERS)
+    if(Game_finished != Num_players)
        pauseForUser();
     return;
   }
@@ -891,7 +2873,7 @@ void display_player_alert(int p_idx, int rank) {
   wbkgd(battle_win, COLOR_PAIR(11));
 
   // Display battle title based on battle type
-  wattron(battle_win, COLOR_PAIR(players[p_idx - 1].color_pair) | A_BOLD);
+  wattron(battle_win, COLOR_PAIR(players.info[p_idx - 1].color_pair) | A_BOLD);
   if (rank > 0) {
     mvwprintw(battle_win, 2, 2, "PLAYER REACHED GOAL!");
     // figlet goal
@@ -920,8 +2902,9 @@ void display_player_alert(int p_idx, int rank) {
     mvwprintw(battle_win, 20, 1, R"(| |__| |_| |___) | |___|  _ <|_|)");
     mvwprintw(battle_win, 21, 1, R"(|_____\___/|____/|_____|_| \_(_))");
   }
-  show_battle_art(1, 1, 1, 1, p_idx - 1, -1);
-  wattroff(battle_win, COLOR_PAIR(players[p_idx - 1].color_pair) | A_BOLD);
+  draw_battler(2, 1, p_idx - 1, players.strength[p_idx - 1],
+               players.battles_won[p_idx - 1]);
+  wattroff(battle_win, COLOR_PAIR(players.info[p_idx - 1].color_pair) | A_BOLD);
   wnoutrefresh(battle_win);
   pauseForUser(); 
 
@@ -929,17 +2912,19 @@ void display_player_alert(int p_idx, int rank) {
   delwin(battle_win);
   battle_win = NULL; // Good practice to avoid dangling pointers
 
-  // Redraw the main screen
-  // clear();
-  print_maze();
-  display_player_stats();
+  // Redraw the main screen, by the render thread once the lock is let go
+  invalidate_shadow();
+  publish_frame();
 }
 
-// Place teleporters at dead ends
-void place_teleporters() {
+// Place the layout's teleporters at dead ends
+void place_teleporters(Layout *l, uint64_t *rng) {
+  Maze *m = l->maze;
+  l->placed_teleporters = 0;
+
   // Arrays to store dead end positions
-  int *dead_ends_x = (int *)malloc(maze->rows * maze->cols * sizeof(int));
-  int *dead_ends_y = (int *)malloc(maze->rows * maze->cols * sizeof(int));
+  int *dead_ends_x = (int *)malloc(m->rows * m->cols * sizeof(int));
+  int *dead_ends_y = (int *)malloc(m->rows * m->cols * sizeof(int));
   int dead_end_count = 0;
 
   if (!dead_ends_x || !dead_ends_y) {
@@ -949,9 +2934,9 @@ void place_teleporters() {
   }
 
   // Find all dead ends
-  for (int y = 1; y < maze->rows - 1; y++) {
-    for (int x = 1; x < maze->cols - 1; x++) {
-      if (is_dead_end(x, y)) {
+  for (int y = 1; y < m->rows - 1; y++) {
+    for (int x = 1; x < m->cols - 1; x++) {
+      if (is_dead_end(m, x, y)) {
         dead_ends_x[dead_end_count] = x;
         dead_ends_y[dead_end_count] = y;
         dead_end_count++;
@@ -968,13 +2953,13 @@ void place_teleporters() {
 
   // Adjust number of teleporters based on available dead ends
   int max_possible_teleporters = dead_end_count / 2;
-  Num_teleporters = (max_possible_teleporters < Num_teleporters)
-                        ? max_possible_teleporters
-                        : Num_teleporters;
+  int count = (max_possible_teleporters < l->num_teleporters)
+                  ? max_possible_teleporters
+                  : l->num_teleporters;
 
   // Place teleporters at randomly selected dead ends
-  for (int i = 0; i < Num_teleporters; i++) {
-    int idx1 = rand() % dead_end_count;
+  for (int i = 0; i < count; i++) {
+    int idx1 = layout_rand(rng) % dead_end_count;
     int x1 = dead_ends_x[idx1];
     int y1 = dead_ends_y[idx1];
 
@@ -983,7 +2968,7 @@ void place_teleporters() {
     dead_ends_y[idx1] = dead_ends_y[dead_end_count - 1];
     dead_end_count--;
 
-    int idx2 = rand() % dead_end_count;
+    int idx2 = layout_rand(rng) % dead_end_count;
     int x2 = dead_ends_x[idx2];
     int y2 = dead_ends_y[idx2];
 
@@ -994,157 +2979,321 @@ void place_teleporters() {
 
     // Skip corners (player start/end positions)
     if ((x1 <= 2 && y1 <= 2) ||
-        (x1 >= maze->cols - 3 && y1 <= 2) ||
-        (x1 <= 2 && y1 >= maze->rows - 3) ||
-        (x1 >= maze->cols - 3 && y1 >= maze->rows - 3)
+        (x1 >= m->cols - 3 && y1 <= 2) ||
+        (x1 <= 2 && y1 >= m->rows - 3) ||
+        (x1 >= m->cols - 3 && y1 >= m->rows - 3)
     ) {
       i--;
       continue;
     }
     if ((x2 <= 2 && y2 <= 2) ||
-        (x2 >= maze->cols - 3 && y2 <= 2) ||
-        (x2 <= 2 && y2 >= maze->rows - 3) ||
-        (x2 >= maze->cols - 3 && y2 >= maze->rows - 3)
+        (x2 >= m->cols - 3 && y2 <= 2) ||
+        (x2 <= 2 && y2 >= m->rows - 3) ||
+        (x2 >= m->cols - 3 && y2 >= m->rows - 3)
     ) {
       i--;
       continue;
     }
 
     // Place teleporters
-    teleporters[i].x1 = x1;
-    teleporters[i].y1 = y1;
-    teleporters[i].x2 = x2;
-    teleporters[i].y2 = y2;
-
-    maze->grid[y1][x1] = TELEPORTER;
-    maze->grid[y2][x2] = TELEPORTER;
+    l->teleporters[i].x1 = x1;
+    l->teleporters[i].y1 = y1;
+    l->teleporters[i].x2 = x2;
+    l->teleporters[i].y2 = y2;
+    l->placed_teleporters = i + 1;
+
+    m->grid[y1][x1] = TELEPORTER;
+    m->grid[y2][x2] = TELEPORTER;
   }
 
   free(dead_ends_x);
   free(dead_ends_y);
 }
 
-// Place monsters at random locations, avoiding teleporters and corners
-void place_monsters() {
-  for (int i = 0; i < Num_monsters; i++) {
+// Pick the layout's monster spawns at random locations, avoiding
+// teleporters and corners
+void place_monsters(Layout *l, uint64_t *rng) {
+  Maze *m = l->maze;
+
+  l->monsters.clear();
+  for (int i = 0; i < l->num_monsters; i++) {
+    MonsterSpawn spawn;
     // Find a random empty space
     int x, y;
     int attempts = 0;
 
     do {
-      x = rand() % (maze->cols - 4) + 2; // Avoid edges and corners
-      y = rand() % (maze->rows - 4) + 2;
+      x = layout_rand(rng) % (m->cols - 4) + 2; // Avoid edges and corners
+      y = layout_rand(rng) % (m->rows - 4) + 2;
       attempts++;
 
       // Skip if we can't find a spot after many attempts
       if (attempts > MAX_ATTEMPTS) {
-        Num_monsters = i;
         return;
       }
 
       // Skip corners (player start/end positions)
-      if ((x <= 2 && y <= 2) || (x >= maze->cols - 3 && y <= 2) ||
-          (x <= 2 && y >= maze->rows - 3) ||
-          (x >= maze->cols - 3 && y >= maze->rows - 3)) {
+      if ((x <= 2 && y <= 2) || (x >= m->cols - 3 && y <= 2) ||
+          (x <= 2 && y >= m->rows - 3) ||
+          (x >= m->cols - 3 && y >= m->rows - 3)) {
         continue;
       }
-    } while (maze->grid[y][x] != PATH || is_dead_end(x, y));
-
-    // Place monster
-    monsters[i].x = x;
-    monsters[i].y = y;
+    } while (m->grid[y][x] != PATH || is_dead_end(m, x, y));
 
+    spawn.x = x;
+    spawn.y = y;
     // Random direction
-    int dir = rand() % 4;
-    monsters[i].dx = Base_dx[dir];
-    monsters[i].dy = Base_dy[dir];
-
+    spawn.dir = layout_rand(rng) % 4;
     // Random patrol length
-    monsters[i].patrol_length = rand() % 10 + 5;
-    monsters[i].steps = 0;
-
+    spawn.patrol_length = layout_rand(rng) % 10 + 5;
     // Random strength (1-10)
-    monsters[i].strength = rand() % Max_monster_strength + 1;
-
-    // Recovery after fight
-    monsters[i].recovery_turns = 0;
+    spawn.strength = layout_rand(rng) % l->max_strength + 1;
 
-    // Not defeated initially
-    monsters[i].defeated = 0;
+    m->grid[y][x] = MONSTER;
+    l->monsters.push_back(spawn);
+  }
+}
 
-    maze->grid[y][x] = MONSTER;
+// Period of a new bot or monster: the base period varied by up to
+// +/- Speed_spread percent (no random draw when there is no spread)
+int entity_period(int base) {
+  if (Speed_spread <= 0) {
+    return base;
   }
+  int pct = rand() % (2 * Speed_spread + 1) - Speed_spread;
+  int period = base * (100 + pct) / 100;
+  return period < 1 ? 1 : period;
 }
 
-// Update monster positions
+// Monsters due at this time take their turns: one movement pass, then one
+// collision pass, both in index order as monsters share the grid and RNG
 void update_monsters() {
-  for (int i = 0; i < Num_monsters; i++) {
-    // Skip defeated monsters
-    if (monsters[i].defeated) {
-      continue;
+  // The field is refreshed once per default monster period, a monster
+  // follows the scent a few moves old
+  if (Monster_pursuit && !Due_monsters.empty() &&
+      (Flow_time < 0 || Game_time >= Flow_time + MONSTER_PERIOD ||
+       Game_time < Flow_time)) {
+    build_flow_field();
+    Flow_time = Game_time;
+  }
+  for (int i : Due_monsters) {
+    move_monster_turn(i);
+  }
+  for (int i : Due_monsters) {
+    collide_monster(i);
+    if (Monster_pursuit) {
+      catch_bot(i);
     }
+  }
+}
 
-    // decrement recovery_turns
-    if (monsters[i].recovery_turns)
-      monsters[i].recovery_turns--;
-
-    // Clear current position
-    maze->grid[monsters[i].y][monsters[i].x] = PATH;
+// Cells a pursuing monster may step onto: open path and bot trails, but
+// not walls, goals, teleporters or beaten monsters
+__attribute__((no_instrument_function)) static inline
+int monster_can_enter(Cell c) {
+  return c == PATH || c == MONSTER || CELL_KIND(c) == VISITED_BASE ||
+         CELL_KIND(c) == SOLUTION_BASE;
+}
 
-    // Update position
-    monsters[i].steps++;
-    if (monsters[i].steps >= monsters[i].patrol_length) {
-      // Change direction
-      int dir = rand() % 4;
-      monsters[i].dx = Base_dx[dir];
-      monsters[i].dy = Base_dy[dir];
-      monsters[i].steps = 0;
+// Pursuit flow field: a BFS from every racing bot at once over the cells
+// monsters may enter, out to PURSUIT_RADIUS moves. One pass serves all the
+// monsters due this tick however many there are, and it only visits (and
+// next time clears) the cells near the bots, not the whole maze
+void build_flow_field() {
+  int rows = maze->rows, cols = maze->cols;
+  size_t cells = (size_t) rows * (size_t) cols;
+
+  if (Flow_dist.size() != cells) {
+    Flow_dist.assign(cells, FLOW_NONE);
+    Flow_queue.clear();
+  }
+  for (unsigned c : Flow_queue) {
+    Flow_dist[(c >> 16) * (size_t) cols + (c & 0xFFFF)] = FLOW_NONE;
+  }
+  Flow_queue.clear();
+  for (int p = 0; p < Num_players; p++) {
+    if (players.reached_goal[p] || players.abandoned_race[p]) {
+      continue;
     }
+    int x = players.current[p].x, y = players.current[p].y;
+    uint8_t *dist = &Flow_dist[(size_t) (y * cols + x)];
+    if (*dist == FLOW_NONE) {
+      *dist = 0;
+      Flow_queue.push_back((unsigned) (y << 16 | x));
+    }
+  }
+  for (size_t head = 0; head < Flow_queue.size(); head++) {
+    int x = (int) (Flow_queue[head] & 0xFFFF), y = (int) (Flow_queue[head] >> 16);
+    int dist = Flow_dist[(size_t) (y * cols + x)] + 1;
+    if (dist > PURSUIT_RADIUS) {
+      break; // BFS order: everything after is as far
+    }
+    for (int dir = 0; dir < 4; dir++) {
+      int nx = x + Base_dx[dir], ny = y + Base_dy[dir];
+      if (nx <= 0 || nx >= cols - 1 || ny <= 0 || ny >= rows - 1) {
+        continue;
+      }
+      uint8_t *next = &Flow_dist[(size_t) (ny * cols + nx)];
+      if (*next == FLOW_NONE && monster_can_enter(maze->grid[ny][nx])) {
+        *next = (uint8_t) dist;
+        Flow_queue.push_back((unsigned) (ny << 16 | nx));
+      }
+    }
+  }
+}
 
-    // Try to move
-    int newX = monsters[i].x + monsters[i].dx;
-    int newY = monsters[i].y + monsters[i].dy;
-    char cell = maze->grid[newY][newX];
-
-    // Check if the new position is valid and not a special cell
-    if (newX > 0 && newX < maze->cols - 1 && newY > 0 &&
-        newY < maze->rows - 1 && (cell == PATH || cell == MONSTER)) {
-      monsters[i].x = newX;
-      monsters[i].y = newY;
-    } else {
-      // Change direction if blocked
+// One step for a pursuing monster: down the flow field toward the nearest
+// bot, or on along its patrol when no bot is near. It crosses bot
+// trails, so it keeps the code of the cell it stands on and puts it back
+void pursue_step(int i) {
+  int x = monsters.x[i], y = monsters.y[i];
+  int cols = maze->cols;
+  int best = Flow_dist[(size_t) (y * cols + x)];
+  int chase = -1;
+
+  // Most monsters are nowhere near a bot: one look at their own cell (a
+  // cell next to a near one is near too, or at the radius)
+  for (int dir = 0; best != FLOW_NONE && dir < 4; dir++) {
+    int nx = x + Base_dx[dir], ny = y + Base_dy[dir];
+    int dist = Flow_dist[(size_t) (ny * cols + nx)];
+    if (dist < best && monster_can_enter(maze->grid[ny][nx])) {
+      best = dist;
+      chase = dir;
+    }
+  }
+  if (chase >= 0) {
+    monsters.dx[i] = Base_dx[chase];
+    monsters.dy[i] = Base_dy[chase];
+    monsters.steps[i] = 0;
+  } else {
+    // Patrol, as move_monster_turn() does
+    monsters.steps[i]++;
+    if (monsters.steps[i] >= monsters.patrol_length[i]) {
       int dir = rand() % 4;
-      monsters[i].dx = Base_dx[dir];
-      monsters[i].dy = Base_dy[dir];
-      monsters[i].steps = 0;
+      monsters.dx[i] = Base_dx[dir];
+      monsters.dy[i] = Base_dy[dir];
+      monsters.steps[i] = 0;
     }
+  }
 
-    // Mark new position
-    maze->grid[monsters[i].y][monsters[i].x] = MONSTER;
+  int newX = x + monsters.dx[i];
+  int newY = y + monsters.dy[i];
+  Cell cell = maze->grid[newY][newX];
+  if (newX > 0 && newX < cols - 1 && newY > 0 && newY < maze->rows - 1 &&
+      monster_can_enter(cell)) {
+    // Under a monster that is already there lies what it stands on
+    int other = check_monster(newX, newY);
+    Cell under = cell != MONSTER ? cell
+                 : other         ? monsters.under[other - 1]
+                                 : PATH;
+    move_monster(i, newX, newY);
+    if (!check_monster(x, y)) {
+      set_cell(x, y, monsters.under[i]);
+    }
+    monsters.under[i] = under;
+    set_cell(newX, newY, MONSTER);
+  } else if (chase < 0) {
+    // Change direction if blocked
+    int dir = rand() % 4;
+    monsters.dx[i] = Base_dx[dir];
+    monsters.dy[i] = Base_dy[dir];
+    monsters.steps[i] = 0;
   }
+}
 
-  // Check for monster vs monster collisions
-  for (int i = 0; i < Num_monsters; i++) {
-    // Skip defeated monsters
-    if (monsters[i].defeated) {
+// A pursuing monster that has caught up with a racing bot battles it
+void catch_bot(int i) {
+  if (monsters.defeated[i]) {
+    return;
+  }
+  int x = monsters.x[i], y = monsters.y[i];
+  for (int b = maze->bot_at[y][x]; b; b = players.next_at[b - 1]) {
+    int p = b - 1;
+    if (players.reached_goal[p] || players.abandoned_race[p]) {
       continue;
     }
+    if (battle_bot_monster(i, p + 1) == 0) {
+      check_battles_lost(p);
+    }
+    break; // one battle a move
+  }
+}
 
-    for (int j = i + 1; j < Num_monsters; j++) {
-      // Skip defeated monsters
-      if (monsters[j].defeated) {
-        continue;
-      }
+// One move of a live monster: a patrol step, or with --pursuit a step
+// toward the nearest bot
+void move_monster_turn(int i) {
+  int old_x = monsters.x[i], old_y = monsters.y[i];
+
+  if (Monster_pursuit) {
+    pursue_step(i);
+  } else {
+    patrol_step(i);
+  }
+  // monsters take their turns in index order, so only the gap is recorded
+  int dir = step_direction(monsters.x[i] - old_x, monsters.y[i] - old_y);
+  int skipped = i - Record_monster - 1;
+  Record_monster = i;
+  record_event((uint64_t) (skipped * 5 + (dir < 0 ? 4 : dir)) << 3 |
+               EV_MONSTER);
+}
 
-      // Check if monsters are in the same cell
-      if (monsters[i].x == monsters[j].x && monsters[i].y == monsters[j].y) {
-        // Battle the monsters
-        battle_monsters(i, j);
+// One patrol step: on in the monster's direction, a new random one when
+// the patrol is done or the way is blocked
+void patrol_step(int i) {
+  // Clear current position
+  set_cell(monsters.x[i], monsters.y[i], PATH);
 
-        // After battle, the winner stays at the position, loser is already
-        // marked as defeated So no additional position updates needed
-      }
+  // Update position
+  monsters.steps[i]++;
+  if (monsters.steps[i] >= monsters.patrol_length[i]) {
+    // Change direction
+    int dir = rand() % 4;
+    monsters.dx[i] = Base_dx[dir];
+    monsters.dy[i] = Base_dy[dir];
+    monsters.steps[i] = 0;
+  }
+
+  // Try to move
+  int newX = monsters.x[i] + monsters.dx[i];
+  int newY = monsters.y[i] + monsters.dy[i];
+  Cell cell = maze->grid[newY][newX];
+
+  // Check if the new position is valid and not a special cell
+  if (newX > 0 && newX < maze->cols - 1 && newY > 0 &&
+      newY < maze->rows - 1 && (cell == PATH || cell == MONSTER)) {
+    move_monster(i, newX, newY);
+  } else {
+    // Change direction if blocked
+    int dir = rand() % 4;
+    monsters.dx[i] = Base_dx[dir];
+    monsters.dy[i] = Base_dy[dir];
+    monsters.steps[i] = 0;
+  }
+
+  // Mark new position
+  set_cell(monsters.x[i], monsters.y[i], MONSTER);
+}
+
+// Check a monster that just moved for monster vs monster collisions
+void collide_monster(int i) {
+  // Only the monsters sharing this cell can collide with it
+  for (int j1 = maze->monster_at[monsters.y[i]][monsters.x[i]]; j1;
+       j1 = monsters.next_at[j1 - 1]) {
+    int j = j1 - 1;
+    // Stop once this monster is beaten
+    if (monsters.defeated[i]) {
+      break;
+    }
+    // Skip self, defeated monsters and pairs the other monster checks
+    if (j == i || monsters.defeated[j] || (Monster_due[j] && j < i)) {
+      continue;
     }
+
+    // Battle the monsters
+    battle_monsters(i, j);
+
+    // After battle, the winner stays at the position, loser is already
+    // marked as defeated So no additional position updates needed
   }
 }
 
@@ -1166,160 +3315,162 @@ int check_teleporter(int x, int y, int *newX, int *newY) {
 
 // Check if position has a monster and return its index
 int check_monster(int x, int y) {
-  for (int i = 0; i < Num_monsters; i++) {
-    if (monsters[i].x == x && monsters[i].y == y && !monsters[i].defeated) {
-      return i + 1; // Return monster index + 1 (so 0 means no monster)
+  int found = 0;
+  for (int m = maze->monster_at[y][x]; m; m = monsters.next_at[m - 1]) {
+    // lowest live index wins, as with a scan over all monsters
+    if (!monsters.defeated[m - 1] && (!found || m < found)) {
+      found = m;
     }
   }
-  return 0; // No monster
+  return found; // Return monster index + 1 (so 0 means no monster)
 }
 
-//                              winner         battle
-//                 art/figlet, left/right,      type, player/monster  left-index
-//                 right-index
-void show_battle_art(int aart, int leftside, int type, int player, int left_idx, int right_idx) {
-  // Set the recovery time (in turns) for both winner and loser
-  const int WINNER_RECOVERY_TURNS = 3;
-  const int LOSER_RECOVERY_TURNS  = 6;
-
-  // Show ascii-art of battler /////////////////////////////////////////////
-  if (aart) {
-    if (ShowWindows == 0) return;
-    int col = leftside ? 2 : 23;
-    int idx = leftside ? left_idx : right_idx;
-    if (player) { // Player Bot
-      wattron(battle_win, COLOR_PAIR(players[idx].color_pair) | A_BOLD);
-      mvwprintw(battle_win, 4, col, "%s", BOT_NAMES_LONG[idx + 1]);
-      mvwprintw(battle_win, 5, col, "STR: %d  WINS: %d", players[idx].strength,
-                players[idx].battles_won);
-
-      // Bot ASCII Art
-      mvwprintw(battle_win,  6, col, R"(               )");
-      mvwprintw(battle_win,  7, col, R"(     ____      )");
-      mvwprintw(battle_win,  8, col, R"(    /    \     )");
-      mvwprintw(battle_win,  9, col, R"(   | o  o |    )");
-      mvwprintw(battle_win, 10, col, R"(   | ____ |    )");
-      mvwprintw(battle_win, 11, col, R"(   ||____||    )");
-      mvwprintw(battle_win, 12, col, R"(    \____/     )");
-      mvwprintw(battle_win, 13, col, R"(               )");
-      wattroff(battle_win, COLOR_PAIR(players[idx].color_pair) | A_BOLD);
-    } else { // Monster
-      wattron(battle_win, COLOR_PAIR(8) | A_BOLD);
-      mvwprintw(battle_win, 4, col, "%s", MONSTER_NAMES_R[idx]);
-      mvwprintw(battle_win, 5, col, "Strength: %d    ", monsters[idx].strength);
-
-      // Monster ASCII Art
-      mvwprintw(battle_win,  6, col, R"(    .----,     )");
-      mvwprintw(battle_win,  7, col, R"(   /      \    )");
-      mvwprintw(battle_win,  8, col, R"(  |  O  O  |   )");
-      mvwprintw(battle_win,  9, col, R"(  | .vvvv. |   )");
-      mvwprintw(battle_win, 10, col, R"(  / |    | \   )");
-      mvwprintw(battle_win, 11, col, R"( /  `^^^^'  \  )");
-      mvwprintw(battle_win, 12, col, R"(/  /|     |\ \.)");
-      mvwprintw(battle_win, 13, col, R"(\_/ .~~~~~. \_/)");
-      wattroff(battle_win, COLOR_PAIR(8) | A_BOLD);
-    }
-    // update stats for winner and loser /////////////////////////////////////
-  } else {
-    int widx, lidx;
-    int winner_is_player = ((type == 0 && leftside)  || (type == 1));
-    int loser_is_player  = ((type == 0 && !leftside) || (type == 1));
-    if (leftside) {
-      widx = left_idx;
-      lidx = right_idx;
-    } else {
-      lidx = left_idx;
-      widx = right_idx;
-    }
-    // handle winner /////////////////
-    if (winner_is_player) {
-      // winner is player
-      players[widx].strength += 1;
-      players[widx].battles_won += 1;
-      players[widx].recovery_turns = WINNER_RECOVERY_TURNS;
-    } else {
-      // winner is monster
-      monsters[widx].strength += 1;
-      monsters[widx].recovery_turns = WINNER_RECOVERY_TURNS;
-    }
-    // handle loser //////////////////
-    if (loser_is_player) {
-      // loser is player
-      players[lidx].battles_lost += 1;
-      players[lidx].recovery_turns = LOSER_RECOVERY_TURNS;
-      update_status_line("%s %s!", BOT_NAMES_F[lidx + 1], LOST_MSG);
-    } else {
-      // loser is monster
-      Liv_monsters--;
-      monsters[lidx].defeated = 1;
-      maze->grid[monsters[lidx].y][monsters[lidx].x] = DEFEATED_MONSTER;
-      update_status_line("%s %s!", MONSTER_NAMES_R[lidx], LOST_MSG);
-    }
-
-    if (ShowWindows != 0) {
-      // X out eyes of loser
-      int los_col = leftside ? 23 : 2;
-      if (loser_is_player) {
-        // bot
-        mvwprintw(battle_win, 9, los_col + 2, R"( | x  x | )");
-      } else {
-        // monster
-        mvwprintw(battle_win, 8, los_col + 1, R"( |  X  X  | )");
-      }
-      
-      // Show "Wins!" text with correct positioning ////////////////////////
-      int win_col = leftside ? 1 : 23;
-      mvwprintw(battle_win, 17, win_col, R"( _    _ _       )");
-      mvwprintw(battle_win, 18, win_col, R"(| |  | (_)_ __  )");
-      mvwprintw(battle_win, 19, win_col, R"(| |/\| | | '_ \ )");
-      mvwprintw(battle_win, 20, win_col, R"(|  __  | | | | |)");
-      mvwprintw(battle_win, 21, win_col, R"(|_/  \_|_|_| |_|)");
-    }
+// Draw one side of the battle window: name, stats and ASCII art
+void draw_battler(int col, int is_bot, int idx, int strength, int wins) {
+  if (is_bot) { // Player Bot
+    wattron(battle_win, COLOR_PAIR(players.info[idx].color_pair) | A_BOLD);
+    mvwprintw(battle_win, 4, col, "%s", players.info[idx].long_name);
+    mvwprintw(battle_win, 5, col, "STR: %d  WINS: %d", strength, wins);
+
+    // Bot ASCII Art
+    mvwprintw(battle_win,  6, col, R"(               )");
+    mvwprintw(battle_win,  7, col, R"(     ____      )");
+    mvwprintw(battle_win,  8, col, R"(    /    \     )");
+    mvwprintw(battle_win,  9, col, R"(   | o  o |    )");
+    mvwprintw(battle_win, 10, col, R"(   | ____ |    )");
+    mvwprintw(battle_win, 11, col, R"(   ||____||    )");
+    mvwprintw(battle_win, 12, col, R"(    \____/     )");
+    mvwprintw(battle_win, 13, col, R"(               )");
+    wattroff(battle_win, COLOR_PAIR(players.info[idx].color_pair) | A_BOLD);
+  } else { // Monster
+    wattron(battle_win, COLOR_PAIR(8) | A_BOLD);
+    mvwprintw(battle_win, 4, col, "%s", monsters.info[idx].name);
+    mvwprintw(battle_win, 5, col, "Strength: %d    ", strength);
+
+    // Monster ASCII Art
+    mvwprintw(battle_win,  6, col, R"(    .----,     )");
+    mvwprintw(battle_win,  7, col, R"(   /      \    )");
+    mvwprintw(battle_win,  8, col, R"(  |  O  O  |   )");
+    mvwprintw(battle_win,  9, col, R"(  | .vvvv. |   )");
+    mvwprintw(battle_win, 10, col, R"(  / |    | \   )");
+    mvwprintw(battle_win, 11, col, R"( /  `^^^^'  \  )");
+    mvwprintw(battle_win, 12, col, R"(/  /|     |\ \.)");
+    mvwprintw(battle_win, 13, col, R"(\_/ .~~~~~. \_/)");
+    wattroff(battle_win, COLOR_PAIR(8) | A_BOLD);
   }
 }
 
-// Unified battle function that handles all battle scenarios
-// Type: 0 = player vs monster, 1 = player vs player, 2 = monster vs monster
-int battle_unified(int combatant1_idx, int combatant2_idx, int type) {
-  // Get player indices if needed (for player vs monster or player vs player)
-  int p1_idx = (type == 0 || type == 1) ? combatant1_idx - 1
-                                        : -1; // Adjust for 0-based indexing
-  int p2_idx =
-      (type == 1) ? combatant2_idx - 1 : -1; // Adjust for 0-based indexing
+// Resolve a battle and update the winner and loser, nothing is drawn (see
+// present_battle). Type: 0 = bot vs monster, 1 = bot vs bot, 2 = monster
+// vs monster; left and right are bot or monster indexes to match
+BattleOutcome resolve_battle(int type, int left, int right) {
+  // Set the recovery time (in turns) for both winner and loser
+  const int WINNER_RECOVERY_TURNS = 3;
+  const int LOSER_RECOVERY_TURNS  = 6;
+  BattleOutcome b = {};
+  int idx[2] = {left, right};
 
-  // Get monster indices if needed (for player vs monster or monster vs monster)
-  int m1_idx = (type == 0) ? combatant2_idx : (type == 2 ? combatant1_idx : -1);
-  int m2_idx = (type == 2) ? combatant2_idx : -1;
+  b.type = type;
+  b.left = left;
+  b.right = right;
+  b.is_bot[0] = type != 2;
+  b.is_bot[1] = type == 1;
 
   // Check if any combatant is in recovery mode - if so, skip battle entirely
-  if ((type == 0 || type == 1) && players[p1_idx].recovery_turns > 0) {
-    // Player 1 is recovering, no battle
-    return -1; // Special code indicating battle was skipped
+  if (type != 2 && players.recovery_until[left] > Game_time) {
+    return b;
+  }
+  if (type == 1 && players.recovery_until[right] > Game_time) {
+    return b;
+  }
+  if (type == 0 && !monsters.defeated[right] &&
+      monsters.recovery_until[right] > Game_time) {
+    return b;
+  }
+  if (type == 2 && (monsters.recovery_until[left] > Game_time ||
+                    monsters.recovery_until[right] > Game_time)) {
+    return b;
   }
+  b.fought = 1;
+
+  // Battle spot, and the sides as they went in
+  b.x = b.is_bot[0] ? players.current[left].x : monsters.x[left];
+  b.y = b.is_bot[0] ? players.current[left].y : monsters.y[left];
+  for (int s = 0; s < 2; s++) {
+    b.strength[s] = b.is_bot[s] ? players.strength[idx[s]]
+                                : monsters.strength[idx[s]];
+    b.wins[s] = b.is_bot[s] ? players.battles_won[idx[s]] : 0;
+  }
+
+  // Roll, left then right
+  b.roll[0] = b.strength[0] + (rand() % 6);
+  b.roll[1] = b.strength[1] + (rand() % 6);
 
-  if (type == 1 && players[p2_idx].recovery_turns > 0) {
-    // Player 2 is recovering, no battle
-    return -1; // Special code indicating battle was skipped
+  // For player vs monster, player wins on tie
+  if (type == 0) {
+    b.left_wins = (b.roll[0] >= b.roll[1]);
+  }
+  // For player vs player or monster vs monster, higher roll wins
+  // In case of tie, first combatant wins unless weaker (the resolve order
+  // is shuffled every tick, so being first is no lasting advantage)
+  else {
+    b.left_wins = (b.roll[0] > b.roll[1] ||
+                   (b.roll[0] == b.roll[1] && b.strength[0] >= b.strength[1]));
   }
 
-  if (type == 0 && !monsters[m1_idx].defeated &&
-      monsters[m1_idx].recovery_turns > 0) {
-    // Monster is recovering, no battle
-    return -1;
+  record_event((uint64_t) (type * 2 + b.left_wins) << 3 | EV_BATTLE);
+  record_event((uint64_t) left);
+  record_event((uint64_t) right);
+  if (Hash_file) {
+    Hash_touched.push_back(b.is_bot[0] ? left : -1 - left);
+    Hash_touched.push_back(b.is_bot[1] ? right : -1 - right);
   }
 
-  if (type == 2) {
-    if (monsters[m1_idx].recovery_turns > 0 ||
-        monsters[m2_idx].recovery_turns > 0) {
-      // One of the monsters is recovering, no battle
-      return -1;
-    }
+  // handle winner /////////////////
+  int w = b.left_wins ? 0 : 1;
+  int widx = idx[w], lidx = idx[1 - w];
+  if (b.is_bot[w]) {
+    players.strength[widx] += 1;
+    players.battles_won[widx] += 1;
+    players.recovery_until[widx] =
+        Game_time + WINNER_RECOVERY_TURNS * players.period[widx];
+  } else {
+    monsters.strength[widx] += 1;
+    monsters.recovery_until[widx] =
+        Game_time + WINNER_RECOVERY_TURNS * monsters.period[widx];
+  }
+  // handle loser //////////////////
+  if (b.is_bot[1 - w]) {
+    players.battles_lost[lidx] += 1;
+    players.recovery_until[lidx] =
+        Game_time + LOSER_RECOVERY_TURNS * players.period[lidx];
+  } else {
+    Liv_monsters--;
+    monsters.defeated[lidx] = 1;
+    set_cell(monsters.x[lidx], monsters.y[lidx], DEFEATED_MONSTER);
   }
+  return b;
+}
+
+// Show a resolved battle: the bullseye on the spot, with -w the battle
+// window with both sides as they went in, the rolls and the winner, then
+// the redrawn maze. Draws nothing when headless or no battle took place.
+// The animation and the pause hold up the game anyway, so the whole of it
+// holds Curses_lock (the effects it calls take it again, recursively):
+// either all of it is shown or, for a slow terminal, none
+void present_battle(const BattleOutcome *b) {
+  if (Headless || Fast_forward || !b->fought)
+    return;
+  if (Frame_cap && ShowWindows == 0)
+    return; // a slow terminal gets the outcome with the next frame
+  CursesLock lock;
+  int w = b->left_wins ? 0 : 1;
+  int lidx = w ? b->left : b->right;
 
   // show battle spot
-  int be_x = (type != 2) ? players[p1_idx].current.x : monsters[m1_idx].x;
-  int be_y = (type != 2) ? players[p1_idx].current.y : monsters[m1_idx].y;
-  animate_bullseye(be_y, be_x, 5, (int) (pauseTime/40), 0);
+  if (in_view(b->y, b->x)) {
+    animate_bullseye(b->y - View_y, b->x - View_x, 5, (int) (pauseTime/40), 0);
+  }
 
   if (ShowWindows != 0) {
     // Save current window and create a larger battle screen
@@ -1339,7 +3490,7 @@ int battle_unified(int combatant1_idx, int combatant2_idx, int type) {
     
     // Display battle title based on battle type
     wattron(battle_win, A_BOLD);
-    switch (type) {
+    switch (b->type) {
     case 0:
       mvwprintw(battle_win, 2, 2, "PLAYER VS MONSTER BATTLE");
       break;
@@ -1351,22 +3502,11 @@ int battle_unified(int combatant1_idx, int combatant2_idx, int type) {
       break;
     }
     wattroff(battle_win, A_BOLD | COLOR_PAIR(8) |
-                             (type == 0 ? players[p1_idx].color_pair : 0));
+             (b->type == 0 ? players.info[b->left].color_pair : 0));
     
-    // ASCII art for left combatant
-    if (type == 0 || type == 1) { // Player Bot
-      show_battle_art(1, 1, type, 1, p1_idx, type == 0 ? m1_idx : p2_idx);
-    } else { // Monster
-      show_battle_art(1, 1, type, 0, m1_idx, m2_idx);
-    }
-    
-    //       .... for  right combatant
-    if (type == 1) { // Player Bot
-      show_battle_art(1, 0, type, 1, p1_idx, p2_idx);
-    } else { // Monster
-      show_battle_art(1, 0, type, 0, type == 0 ? p1_idx : m1_idx,
-                      type == 0 ? m1_idx : m2_idx);
-    }
+    // ASCII art for left and right combatant
+    draw_battler(2, b->is_bot[0], b->left, b->strength[0], b->wins[0]);
+    draw_battler(23, b->is_bot[1], b->right, b->strength[1], b->wins[1]);
     
     // Display vs text in the middle
     wattron(battle_win, A_BOLD);
@@ -1377,318 +3517,327 @@ int battle_unified(int combatant1_idx, int combatant2_idx, int type) {
     mvwprintw(battle_win, 14, 5, "╔═════════╗        ╔═════════╗");
     mvwprintw(battle_win, 15, 5, "║         ║        ║         ║");
     mvwprintw(battle_win, 16, 5, "╚═════════╝        ╚═════════╝");
-    
-    wnoutrefresh(battle_win);
-  }
-  
-  // Calculate battle rolls based on combatant types
-  int roll1, roll2;
-
-  // Left combatant roll
-  if (type == 0 || type == 1) { // Player
-    roll1 = players[p1_idx].strength + (rand() % 6);
-  } else { // Monster
-    roll1 = monsters[m1_idx].strength + (rand() % 6);
-  }
-
-  // Right combatant roll
-  if (type == 1) { // Player
-    roll2 = players[p2_idx].strength + (rand() % 6);
-  } else { // Monster
-    roll2 =
-        (type == 0 ? monsters[m1_idx].strength : monsters[m2_idx].strength) +
-        (rand() % 6);
-  }
 
-  if (ShowWindows != 0) {
     // Display die rolls
-    if (type == 0 || type == 1) { // Left is player
-      wattron(battle_win, COLOR_PAIR(players[p1_idx].color_pair) | A_BOLD);
-      mvwprintw(battle_win, 15, 10, "%d", roll1);
-      wattroff(battle_win, COLOR_PAIR(players[p1_idx].color_pair) | A_BOLD);
-    } else { // Left is monster
-      wattron(battle_win, COLOR_PAIR(8) | A_BOLD);
-      mvwprintw(battle_win, 15, 10, "%d", roll1);
-      wattroff(battle_win, COLOR_PAIR(8) | A_BOLD);
-    }
-    
-    if (type == 1) { // Right is player
-      wattron(battle_win, COLOR_PAIR(players[p2_idx].color_pair) | A_BOLD);
-      mvwprintw(battle_win, 15, 29, "%d", roll2);
-      wattroff(battle_win, COLOR_PAIR(players[p2_idx].color_pair) | A_BOLD);
-    } else { // Right is monster
-      wattron(battle_win, COLOR_PAIR(8) | A_BOLD);
-      mvwprintw(battle_win, 15, 29, "%d", roll2);
-      wattroff(battle_win, COLOR_PAIR(8) | A_BOLD);
+    for (int s = 0; s < 2; s++) {
+      int color = b->is_bot[s]
+                      ? players.info[s ? b->right : b->left].color_pair
+                      : 8;
+      wattron(battle_win, COLOR_PAIR(color) | A_BOLD);
+      mvwprintw(battle_win, 15, s ? 29 : 10, "%d", b->roll[s]);
+      wattroff(battle_win, COLOR_PAIR(color) | A_BOLD);
     }
-    
     wnoutrefresh(battle_win);
   }
-  
-  // Determine winner and loser
-  int left_wins = 0;
 
-  // For player vs monster, player wins on tie
-  if (type == 0) {
-    left_wins = (roll1 >= roll2);
-  }
-  // For player vs player or monster vs monster, higher roll wins
-  // In case of tie, first combatant wins (arbitrary rule)
-  else {
-    left_wins =
-      (roll1 > roll2 ||
-      (roll1 == roll2 && 
-      (type == 1 ? combatant1_idx > combatant2_idx
-      : monsters[m1_idx].strength >=
-      monsters[m2_idx].strength)));
-  }
-
-  // Display result and update stats based on battle type
-  if (left_wins) {
-    // Left combatant wins
-    if (type == 0) {
-      // Player vs monster - player wins
-      show_battle_art(0, 1, type, 1, p1_idx, m1_idx);
-    } else if (type == 1) {
-      // Player vs player - left player wins
-      show_battle_art(0, 1, type, 1, p1_idx, p2_idx);
-    } else {
-      // Monster vs monster - left monster wins
-      show_battle_art(0, 1, type, 0, m1_idx, m2_idx);
-    }
+  if (b->is_bot[1 - w]) {
+    update_status_line("%s %s!", bot_name(lidx), LOST_MSG);
   } else {
-    // Right combatant wins
-    if (type == 0) {
-      // Player vs monster - monster wins
-      show_battle_art(0, 0, type, 0, p1_idx, m1_idx);
-    } else if (type == 1) {
-      // Player vs player - right player wins
-      show_battle_art(0, 0, type, 1, p1_idx, p2_idx);
-    } else {
-      // Monster vs monster - right monster wins
-      show_battle_art(0, 0, type, 0, m1_idx, m2_idx);
-    }
+    update_status_line("%s %s!", monsters.info[lidx].name, LOST_MSG);
   }
 
   if (ShowWindows != 0) {
+    // X out eyes of loser
+    int los_col = w ? 2 : 23;
+    if (b->is_bot[1 - w]) {
+      // bot
+      mvwprintw(battle_win, 9, los_col + 2, R"( | x  x | )");
+    } else {
+      // monster
+      mvwprintw(battle_win, 8, los_col + 1, R"( |  X  X  | )");
+    }
+    
+    // Show "Wins!" text with correct positioning ////////////////////////
+    int win_col = w ? 23 : 1;
+    mvwprintw(battle_win, 17, win_col, R"( _    _ _       )");
+    mvwprintw(battle_win, 18, win_col, R"(| |  | (_)_ __  )");
+    mvwprintw(battle_win, 19, win_col, R"(| |/\| | | '_ \ )");
+    mvwprintw(battle_win, 20, win_col, R"(|  __  | | | | |)");
+    mvwprintw(battle_win, 21, win_col, R"(|_/  \_|_|_| |_|)");
+
     wnoutrefresh(battle_win);
     pauseForUser(); 
     
     // Clean up battle window
     delwin(battle_win);
     battle_win = NULL; // Good practice to avoid dangling pointers
+    invalidate_shadow();
   }
 
-  // Redraw the main screen
-  print_maze();
-  display_player_stats();
-
-  // Return battle result
-  if (type == 0) {
-    return left_wins; // For player vs monster: 1 if player won, 0 if monster
-                      // won
-  } else if (type == 1) {
-    return left_wins ? combatant1_idx : combatant2_idx; // Return winner's ID
-  } else {
-    return left_wins ? combatant1_idx
-                     : combatant2_idx; // Return winner monster index
-  }
+  // Redraw the main screen, by the render thread once the lock is let go
+  publish_frame();
 }
 
-// Convenience wrapper for player vs monster battles
+// Convenience wrapper for player vs monster battles: 1 if the bot won, 0
+// if the monster did, -1 if no battle took place
 int battle_bot_monster(int monster_index, int player_id) {
-  // For player vs monster, combatant1 is player, combatant2 is monster
-  return battle_unified(player_id, monster_index, 0);
+  BattleOutcome b = resolve_battle(0, player_id - 1, monster_index);
+  present_battle(&b);
+  return b.fought ? b.left_wins : -1;
 }
 
-// Convenience wrapper for player vs player battles
+// Convenience wrapper for player vs player battles: the winner's ID, -1 if
+// no battle took place
 int battle_bots(int player1_id, int player2_id) {
-  return battle_unified(player1_id, player2_id, 1);
+  BattleOutcome b = resolve_battle(1, player1_id - 1, player2_id - 1);
+  present_battle(&b);
+  if (!b.fought) {
+    return -1;
+  }
+  return b.left_wins ? player1_id : player2_id;
 }
 
 // Convenience wrapper for monster vs monster battles
 int battle_monsters(int monster1_idx, int monster2_idx) {
-  battle_unified(monster1_idx, monster2_idx, 2);
+  BattleOutcome b = resolve_battle(2, monster1_idx, monster2_idx);
+  present_battle(&b);
   return 0; // Return value not used for monster vs monster
 }
 
-void create_maze(int rows, int cols) {
-  maze = (Maze *)malloc(sizeof(Maze));
-  if (!maze)
-    return;
+// Allocate a rows x cols grid of elements of the given size, zero filled
+void **alloc_plane(int rows, int cols, size_t size) {
+  void **plane = (void **)calloc(rows, sizeof(void *));
+  if (!plane)
+    return NULL;
 
-  maze->rows = rows;
-  maze->cols = cols;
+  for (int i = 0; i < rows; i++) {
+    plane[i] = calloc(cols, size);
+    if (!plane[i]) {
+      // Clean up already allocated memory
+      free_plane(plane, i);
+      return NULL;
+    }
+  }
+  return plane;
+}
 
-  // Allocate memory for the grid
-  maze->grid = (char **)malloc(rows * sizeof(char *));
-  if (!maze->grid) {
-    free(maze);
+void free_plane(void **plane, int rows) {
+  if (!plane)
     return;
+  for (int i = 0; i < rows; i++) {
+    free(plane[i]);
   }
+  free(plane);
+}
 
-  for (int i = 0; i < rows; i++) {
-    maze->grid[i] = (char *)malloc(cols * sizeof(char));
-    if (!maze->grid[i]) {
-      // Clean up already allocated memory
-      for (int j = 0; j < i; j++) {
-        free(maze->grid[j]);
-      }
-      free(maze->grid);
-      free(maze);
-      return;
+Maze *create_maze(int rows, int cols) {
+  Maze *m = (Maze *)calloc(1, sizeof(Maze));
+  if (!m)
+    return NULL;
+
+  m->rows = rows;
+  m->cols = cols;
+
+  // Allocate memory for the grid and the occupancy lists
+  m->grid = (Cell **)alloc_plane(rows, cols, sizeof(Cell));
+  m->bot_at = (int **)alloc_plane(rows, cols, sizeof(int));
+  m->monster_at = (int **)alloc_plane(rows, cols, sizeof(int));
+  m->node_at = (int **)alloc_plane(rows, cols, sizeof(int));
+  // Create separate visited grids for each player
+  m->visited = (char ***)calloc(Num_players, sizeof(char **));
+  if (!m->grid || !m->bot_at || !m->monster_at || !m->node_at ||
+      !m->visited) {
+    free_maze(m);
+    return NULL;
+  }
+  for (int p = 0; p < Num_players; p++) {
+    // Initialize visited grid to unvisited
+    m->visited[p] = (char **)alloc_plane(rows, cols, sizeof(char));
+    if (!m->visited[p]) {
+      free_maze(m);
+      return NULL;
     }
+  }
 
+  for (int i = 0; i < rows; i++) {
     for (int j = 0; j < cols; j++) {
-      maze->grid[i][j] = WALL;
+      m->grid[i][j] = WALL;
     }
   }
 
-  // Create separate visited grids for each player
-  for (int p = 0; p < NUM_PLAYERS; p++) {
-    maze->visited[p] = (char **)malloc(rows * sizeof(char *));
-    if (!maze->visited[p]) {
-      // Clean up already allocated memory
-      for (int i = 0; i < rows; i++) {
-        free(maze->grid[i]);
-      }
-      free(maze->grid);
-      for (int j = 0; j < p; j++) {
-        for (int i = 0; i < rows; i++) {
-          free(maze->visited[j][i]);
-        }
-        free(maze->visited[j]);
-      }
-      free(maze);
-      return;
-    }
+  return m;
+}
 
-    for (int i = 0; i < rows; i++) {
-      maze->visited[p][i] = (char *)malloc(cols * sizeof(char));
-      if (!maze->visited[p][i]) {
-        // Clean up already allocated memory
-        for (int j = 0; j < i; j++) {
-          free(maze->visited[p][j]);
-        }
-        free(maze->visited[p]);
-        for (int j = 0; j < p; j++) {
-          for (int k = 0; k < rows; k++) {
-            free(maze->visited[j][k]);
-          }
-          free(maze->visited[j]);
-        }
-        for (int j = 0; j < rows; j++) {
-          free(maze->grid[j]);
-        }
-        free(maze->grid);
-        free(maze);
-        return;
-      }
+void free_maze(Maze *m) {
+  if (!m)
+    return;
 
-      // Initialize visited grid to unvisited
-      for (int j = 0; j < cols; j++) {
-        maze->visited[p][i][j] = 0;
-      }
+  free_plane((void **)m->grid, m->rows);
+  free_plane((void **)m->bot_at, m->rows);
+  free_plane((void **)m->monster_at, m->rows);
+  free_plane((void **)m->node_at, m->rows);
+
+  // Free the separate visited grids
+  if (m->visited) {
+    for (int p = 0; p < Num_players; p++) {
+      free_plane((void **)m->visited[p], m->rows);
     }
+    free(m->visited);
   }
 
-  return;
+  free(m);
 }
 
-void free_maze() {
-  if (!maze)
-    return;
+// Whether cell (x, y) is set in a bit plane
+__attribute__((no_instrument_function))
+static inline int bit_at(const BitPlane *plane, int x, int y) {
+  return (int) (plane->bits[(size_t) y * (size_t) plane->words +
+                            (size_t) (x >> 6)] >> (x & 63)) & 1;
+}
 
-  if (maze->grid) {
-    for (int i = 0; i < maze->rows; i++) {
-      if (maze->grid[i]) {
-        free(maze->grid[i]);
+// Load the maze's open cells into a bit plane
+void load_open_bits(const Maze *m, BitPlane *open) {
+  open->rows = m->rows;
+  open->cols = m->cols;
+  open->words = (m->cols + 63) / 64;
+  open->bits.assign((size_t) open->rows * (size_t) open->words, 0);
+  for (int y = 0; y < m->rows; y++) {
+    uint64_t *row = &open->bits[(size_t) y * (size_t) open->words];
+    for (int x = 0; x < m->cols; x++) {
+      if (m->grid[y][x] != WALL) {
+        row[x >> 6] |= (uint64_t) 1 << (x & 63);
       }
     }
-    free(maze->grid);
   }
+}
 
-  // Free the separate visited grids
-  for (int p = 0; p < NUM_PLAYERS; p++) {
-    if (maze->visited[p]) {
-      for (int i = 0; i < maze->rows; i++) {
-        if (maze->visited[p][i]) {
-          free(maze->visited[p][i]);
+// Spread the reached cells of one word along its open runs, both ways.
+// Upwards (to higher x) a carry does it in one add: adding a seed to its
+// run of ones clears the run above it. Downwards is an occluded fill in
+// six doubling steps
+__attribute__((no_instrument_function))
+static inline uint64_t fill_word_bits(uint64_t seed, uint64_t open) {
+  uint64_t s = seed & open;
+  s |= ((open + s) ^ open) & open;
+  uint64_t m = open;
+  for (int shift = 1; shift < 64; shift <<= 1) {
+    s |= (s >> shift) & m;
+    m &= m >> shift;
+  }
+  return s;
+}
+
+// Bit-parallel flood fill: grow reach (the seed cells) to every open cell
+// connected to it. Works on whole words, 64 cells at a time: a word taken
+// off the work list fills along its open runs, then hands its new cells
+// to the words above, below and either side, listing those that gained
+// any. Returns the number of word fills
+int flood_fill_bits(const BitPlane *open, BitPlane *reach) {
+  int words = open->words;
+  size_t total = open->bits.size();
+  const uint64_t *o = open->bits.data();
+  uint64_t *r = reach->bits.data();
+  std::vector<size_t> work;
+  std::vector<unsigned char> listed(total);
+  int fills = 0;
+
+  for (size_t i = 0; i < total; i++) {
+    if (r[i]) {
+      work.push_back(i);
+      listed[i] = 1;
+    }
+  }
+  while (!work.empty()) {
+    size_t i = work.back();
+    work.pop_back();
+    listed[i] = 0;
+    fills++;
+
+    uint64_t s = fill_word_bits(r[i], o[i]);
+    r[i] = s;
+    // neighbouring words that gain cells, with the cells they gain
+    size_t next[4];
+    uint64_t gain[4];
+    int n = 0;
+    if (i >= (size_t) words) {
+      next[n] = i - (size_t) words;
+      gain[n++] = s;
+    }
+    if (i + (size_t) words < total) {
+      next[n] = i + (size_t) words;
+      gain[n++] = s;
+    }
+    if (i % (size_t) words > 0) {
+      next[n] = i - 1;
+      gain[n++] = (s & 1) << 63;
+    }
+    if (i % (size_t) words < (size_t) words - 1) {
+      next[n] = i + 1;
+      gain[n++] = s >> 63;
+    }
+    for (int k = 0; k < n; k++) {
+      uint64_t add = gain[k] & o[next[k]] & ~r[next[k]];
+      if (add) {
+        r[next[k]] |= add;
+        if (!listed[next[k]]) {
+          work.push_back(next[k]);
+          listed[next[k]] = 1;
         }
       }
-      free(maze->visited[p]);
     }
   }
+  return fills;
+}
+
+// The open cells connected to (x, y), flood filled into reach. Returns the
+// number of word fills
+int reach_from(const BitPlane *open, BitPlane *reach, int x, int y) {
+  reach->rows = open->rows;
+  reach->cols = open->cols;
+  reach->words = open->words;
+  reach->bits.assign(open->bits.size(), 0);
+  reach->bits[(size_t) y * (size_t) reach->words + (size_t) (x >> 6)] |=
+      (uint64_t) 1 << (x & 63);
+  return flood_fill_bits(open, reach);
+}
+
+// Scalar flood fill for checking flood_fill_bits(): breadth first from the
+// seed cells of reach, one cell at a time, with the result in reach
+void flood_fill_scalar(const BitPlane *open, BitPlane *reach) {
+  int words = open->words;
+  std::vector<unsigned> queue;
 
-  free(maze);
+  for (int y = 0; y < open->rows; y++) {
+    for (int x = 0; x < open->cols; x++) {
+      if (bit_at(reach, x, y)) {
+        queue.push_back((unsigned) y << 16 | (unsigned) x);
+      }
+    }
+  }
+  for (size_t head = 0; head < queue.size(); head++) {
+    int x = (int) (queue[head] & 0xffff), y = (int) (queue[head] >> 16);
+    for (int d = 0; d < 4; d++) {
+      int nx = x + Base_dx[d], ny = y + Base_dy[d];
+      if (nx >= 0 && nx < open->cols && ny >= 0 && ny < open->rows &&
+          bit_at(open, nx, ny) && !bit_at(reach, nx, ny)) {
+        reach->bits[(size_t) ny * (size_t) words + (size_t) (nx >> 6)] |=
+            (uint64_t) 1 << (nx & 63);
+        queue.push_back((unsigned) ny << 16 | (unsigned) nx);
+      }
+    }
+  }
 }
 
 // Implement ensure_path_between_corners to guarantee connectivity
-void ensure_path_between_corners() {
+void ensure_path_between_corners(Maze *m) {
   // Define the four corners
   Position corners[4] = {
       {1, 1, -1, -1},                          // Top-left
-      {maze->cols - 2, 1, -1, -1},             // Top-right
-      {1, maze->rows - 2, -1, -1},             // Bottom-left
-      {maze->cols - 2, maze->rows - 2, -1, -1} // Bottom-right
+      {m->cols - 2, 1, -1, -1},             // Top-right
+      {1, m->rows - 2, -1, -1},             // Bottom-left
+      {m->cols - 2, m->rows - 2, -1, -1} // Bottom-right
   };
 
+  BitPlane open, reach;
+  load_open_bits(m, &open);
+
   // For each pair of corners, ensure a path exists
   for (int i = 0; i < 4; i++) {
-    for (int j = i + 1; j < 4; j++) {
-      // Create a temporary grid to track visited cells for this pathfinding
-      // attempt
-      char **visited = (char **)malloc(maze->rows * sizeof(char *));
-      if (!visited)
-        continue;
-
-      for (int r = 0; r < maze->rows; r++) {
-        visited[r] = (char *)malloc(maze->cols * sizeof(char));
-        if (!visited[r]) {
-          for (int q = 0; q < r; q++) {
-            free(visited[q]);
-          }
-          free(visited);
-          continue;
-        }
-
-        for (int c = 0; c < maze->cols; c++) {
-          visited[r][c] = 0;
-        }
-      }
-
-      // Use BFS to find a path from corner i to corner j
-      Node *queue = NULL;
-      push_stack(&queue, corners[i]);
-      visited[corners[i].y][corners[i].x] = 1;
-
-      int path_found = 0;
+    // Flood fill from corner i to find the corners it reaches
+    reach_from(&open, &reach, corners[i].x, corners[i].y);
 
-      while (!is_empty(queue) && !path_found) {
-        Position current = pop_stack(&queue);
-
-        // Check if we've reached the destination corner
-        if (current.x == corners[j].x && current.y == corners[j].y) {
-          path_found = 1;
-          break;
-        }
-
-        // Try all four directions
-        for (int dir = 0; dir < 4; dir++) {
-          int newX = current.x + Base_dx[dir];
-          int newY = current.y + Base_dy[dir];
-
-          // Check if valid cell and not visited and not a wall
-          if (newX > 0 && newX < maze->cols - 1 && newY > 0 &&
-              newY < maze->rows - 1 && !visited[newY][newX] &&
-              maze->grid[newY][newX] != WALL) {
-
-            visited[newY][newX] = 1;
-            Position newPos = {newX, newY, current.x, current.y};
-            push_stack(&queue, newPos);
-          }
-        }
-      }
+    for (int j = i + 1; j < 4; j++) {
+      int path_found = bit_at(&reach, corners[j].x, corners[j].y);
 
       // If no path found, create one
       if (!path_found) {
@@ -1711,29 +3860,25 @@ void ensure_path_between_corners() {
             y--;
 
           // Carve path
-          maze->grid[y][x] = PATH;
+          m->grid[y][x] = PATH;
         }
+        // the new path joins up more of the maze, fill again
+        load_open_bits(m, &open);
+        reach_from(&open, &reach, corners[i].x, corners[i].y);
       }
-
-      // Clean up
-      for (int r = 0; r < maze->rows; r++) {
-        free(visited[r]);
-      }
-      free(visited);
-      clear_stack(&queue);
     }
   }
 }
 
 // generate_maze to ensure paths between all corners
-void generate_maze() {
+void generate_maze(Maze *m, uint64_t *rng) {
   // First, create a basic maze using DFS
   // Initialize stack for DFS
   Node *stack = NULL;
   Position start = {1, 1, -1, -1};
   push_stack(&stack, start); 
 
-  maze->grid[start.y][start.x] = PATH;
+  m->grid[start.y][start.x] = PATH;
 
   while (!is_empty(stack)) {
     Position current = pop_stack(&stack);
@@ -1746,8 +3891,8 @@ void generate_maze() {
       int newX = current.x + Base_dx[dir] * 2;
       int newY = current.y + Base_dy[dir] * 2;
 
-      if (newX > 0 && newX < maze->cols - 1 && newY > 0 &&
-          newY < maze->rows - 1 && maze->grid[newY][newX] == WALL) {
+      if (newX > 0 && newX < m->cols - 1 && newY > 0 &&
+          newY < m->rows - 1 && m->grid[newY][newX] == WALL) {
         unvisited[count++] = dir;
       }
     }
@@ -1757,16 +3902,16 @@ void generate_maze() {
       push_stack(&stack, current);
 
       // Choose random unvisited neighbor
-      int randDir = unvisited[rand() % count];
+      int randDir = unvisited[layout_rand(rng) % count];
       int newX = current.x + Base_dx[randDir] * 2;
       int newY = current.y + Base_dy[randDir] * 2;
 
       // Remove wall between current cell and chosen cell
-      maze->grid[current.y + Base_dy[randDir]][current.x + Base_dx[randDir]] =
+      m->grid[current.y + Base_dy[randDir]][current.x + Base_dx[randDir]] =
           PATH;
 
       // Mark the chosen cell as part of the path
-      maze->grid[newY][newX] = PATH;
+      m->grid[newY][newX] = PATH;
 
       // Push chosen cell onto stack
       Position newPos = {newX, newY, -1, -1};
@@ -1778,441 +3923,2292 @@ void generate_maze() {
   clear_stack(&stack);
 }
 
-//////////////////////////////////////////////////////
-// function to use player-specific direction arrays
-void solve_maze_multi() {
-  // Create separate stacks for each player to ensure fairness
-  Node *stacks[NUM_PLAYERS] = {NULL, NULL, NULL, NULL};
+// Layout generator: splitmix64 rather than rand() so a layout only depends
+// on its seed and can be built off the main thread
+__attribute__((no_instrument_function))
+static inline int layout_rand(uint64_t *rng) {
+  return (int) (splitmix64(rng) >> 33);
+}
 
-  // This is for tracking player collisions
-  Position previous_positions[NUM_PLAYERS];
-  for (int i = 0; i < NUM_PLAYERS; i++) {
-    // Initialize with invalid positions
-    previous_positions[i].x = -1;
-    previous_positions[i].y = -1;
+// The terminal size the round's maze is made for, borders included:
+// --rows/--cols (headless, their defaults) or else the terminal's. The maze
+// keeps it however the terminal is resized, and is shown a screenful at a
+// time when it doesn't fit
+void round_size(int *rows, int *cols) {
+  int term_rows = Headless ? 0 : Term_rows;
+  int term_cols = Headless ? 0 : Term_cols;
+  if (Maze_rows > 0 || Headless) {
+    term_rows = MAX((Maze_rows > 0 ? Maze_rows : DEF_HEADLESS_ROWS) + 7, MIN_ROWS);
   }
-
-  // Push each player's starting position onto their stack
-  for (int p = 0; p < NUM_PLAYERS; p++) {
-    push_stack(&stacks[p], players[p].start);
-    // Mark start position as visited
-    maze->visited[p][players[p].start.y][players[p].start.x] = 1;
+  if (Maze_cols > 0 || Headless) {
+    term_cols = MAX((Maze_cols > 0 ? Maze_cols : DEF_HEADLESS_COLS) + 3, MIN_COLS);
   }
+  *rows = MIN(term_rows, MAX_ROWS + 6);
+  *cols = MIN(term_cols, MAX_COLS + 2);
+}
 
-  //////////////////////////////////////////////////
-  // Start Main solve loop - continue until all players finish or all stacks are empty
-  while (Players_finished < NUM_PLAYERS) {
-    // Check if all stacks are empty (no more moves for any player)
-    int all_empty = 1;
-    for (int p = 0; p < NUM_PLAYERS; p++) {
-      if (!is_empty(stacks[p]) && !players[p].reached_goal &&
-          !players[p].abandoned_race) {
-        all_empty = 0;
-        break;
-      }
-    }
-
-    // After checking if all stacks are empty:
-    if (all_empty) {
-      // Before breaking, mark any players who didn't finish as having abandoned
-      for (int p = 0; p < NUM_PLAYERS; p++) {
-        if (!players[p].reached_goal && !players[p].abandoned_race) {
-          players[p].abandoned_race = 1;
-          highlight_player_solution_path(p);
-          display_player_alert(p + 1, -1);
-        }
-      }
-      break;
-    }
+// A layout for a terminal of term_rows x term_cols with the current
+// teleporter and monster settings, not built yet
+Layout *make_layout(int term_rows, int term_cols, uint64_t seed) {
+  Layout *l = new Layout();
+  l->term_rows = term_rows;
+  l->term_cols = term_cols;
+  l->num_teleporters = Num_teleporters;
+  l->num_monsters = Num_monsters;
+  l->max_strength = Max_monster_strength;
+  l->seed = seed;
+  return l;
+}
 
-    /////////////////////////////////////////
-    // Start Rotate through players, giving each a turn to move one step
-    for (int p = 0; p < NUM_PLAYERS; p++) {
-      // Skip players who have already reached their goal or abandoned
-      if (players[p].reached_goal || players[p].abandoned_race)
-        continue;
+// Build a layout: the maze, its corner paths, the goals and the teleporters
+// and monsters. Only touches the layout, so it may run on Layout_thread
+void build_layout(Layout *l) {
+  uint64_t rng = l->seed;
 
-      // Check if this player's stack is empty
-      if (is_empty(stacks[p])) {
-        // Mark player as abandoned if their stack is empty and they haven't
-        // reached their goal
-        if (!players[p].abandoned_race && !players[p].reached_goal) {
-          players[p].abandoned_race = 1;
-          highlight_player_solution_path(p);
-          display_player_alert(p + 1, -1);
-        }
-        continue;
-      }
+  if (l->term_rows < MIN_ROWS || l->term_cols < MIN_COLS) {
+    return; // run_round() rejects this size anyway
+  }
+  // Adjust for maze walls and borders (odd sizes)
+  int rows = (l->term_rows - 6) / 2 * 2 - 1; // Reserve space for messages and player stats
+  int cols = (l->term_cols - 2) / 2 * 2 - 1;
 
-      // update current position
-      int player_id = p + 1;
-      Position current = pop_stack(&stacks[p]);
-      players[p].current = current;
+  l->maze = create_maze(rows, cols);
+  if (!l->maze) {
+    return;
+  }
+  // Generate maze using enhanced DFS for paths between corners
+  generate_maze(l->maze, &rng);
+  ensure_path_between_corners(l->maze);
+
+  // Goals first, so that no teleporter or monster lands on one
+  for (int p = 0; p < Num_players; p++) {
+    Position start, end;
+    assign_start_goal(l->maze, p, &start, &end);
+    l->maze->grid[end.y][end.x] = (Cell) (END_BASE + p);
+  }
+  place_teleporters(l, &rng);
+  place_monsters(l, &rng);
+}
 
-      // Check for player vs player collision
-      for (int other_p = 0; other_p < NUM_PLAYERS; other_p++) {
-        // Skip self and players who've reached their goal or abandoned
-        if (other_p == p || players[other_p].reached_goal ||
-            players[other_p].abandoned_race) {
-          continue;
-        }
+// Queue the next round's layout and build it on Layout_thread
+void request_layout(int term_rows, int term_cols, uint64_t seed) {
+  Next_layout = make_layout(term_rows, term_cols, seed);
+  Layout_thread = std::thread(build_layout, Next_layout);
+}
 
-        // Check if players collide
-        if (players[p].current.x == players[other_p].current.x &&
-            players[p].current.y == players[other_p].current.y) {
-
-          // Initiate player vs player battle
-          int winner_id = battle_bots(player_id, other_p + 1);
-
-          // Loser must retreat to previous position
-          if (winner_id == player_id) {
-            // Other player retreats to previous position
-            if (previous_positions[other_p].x != -1) {
-              players[other_p].current = previous_positions[other_p];
-            }
-            // Check if player has lost too many battles
-            if (players[other_p].battles_lost >= 3) {
-              players[other_p].abandoned_race = 2;
-              highlight_player_solution_path(other_p);
-              display_player_alert(other_p + 1, -2);
-
-              // Clear the stack to stop the player's exploration
-              clear_stack(&stacks[other_p]);
-            }
-            continue;
-
-          } else if (winner_id < 0) {
-            ; // no battle took place
-          } else {
-            // Current player retreats to parent position
-            players[p].current.x = current.parentX;
-            players[p].current.y = current.parentY;
-
-            // If no parent position, stay at current but mark as visited to
-            // avoid revisiting
-            if (players[p].current.x == -1 || players[p].current.y == -1) {
-              players[p].current = current;
-              maze->visited[p][current.y][current.x] = 1;
-            }
-            // Check if player has lost too many battles
-            if (players[p].battles_lost >= 3) {
-              players[p].abandoned_race = 2;
-              highlight_player_solution_path(p);
-              display_player_alert(player_id, -2);
-
-              // Clear the stack to stop the player's exploration
-              clear_stack(&stacks[p]);
-            }
-            continue;
-          }
+// Wait for the queued layout and take it, NULL if there is none
+Layout *finish_layout() {
+  if (Layout_thread.joinable()) {
+    Layout_thread.join();
+  }
+  Layout *l = Next_layout;
+  Next_layout = NULL;
+  return l;
+}
 
-          // Update display after battle
-          print_maze();
-          display_player_stats();
-        }
-      }
+void free_layout(Layout *l) {
+  if (!l)
+    return;
+  free_maze(l->maze);
+  delete l;
+}
 
-      // Store current position for potential retreat
-      previous_positions[p].x = players[p].current.x;
-      previous_positions[p].y = players[p].current.y;
-      players[p].moves++;
+// Set up the round's teleporters and monsters from its layout, once maze is
+// the layout's maze and the players are initialized
+void install_layout(Layout *l) {
+  memcpy(teleporters, l->teleporters, sizeof(teleporters));
+  Num_teleporters = l->placed_teleporters;
 
-      // Check if reached the end
-      if (current.x == players[p].end.x && current.y == players[p].end.y) {
-        players[p].reached_goal = 1;
-        Players_finished++;
-        players[p].finished_rank = Players_finished;
+  Num_monsters = (int) l->monsters.size();
+  resize_monsters(Num_monsters);
+  for (int i = 0; i < Num_monsters; i++) {
+    const MonsterSpawn &spawn = l->monsters[(size_t) i];
+    monsters.x[i] = spawn.x;
+    monsters.y[i] = spawn.y;
+    monsters.dx[i] = Base_dx[spawn.dir];
+    monsters.dy[i] = Base_dy[spawn.dir];
+    monsters.patrol_length[i] = spawn.patrol_length;
+    monsters.steps[i] = 0;
+    monsters.strength[i] = spawn.strength;
 
-        // Mark as finished in UI
-        highlight_player_solution_path(p);
-        display_player_alert(player_id, players[p].finished_rank);
-        continue;
-      }
+    // Recovery after fight
+    monsters.recovery_until[i] = 0;
+    monsters.under[i] = PATH;
+    monsters.period[i] = entity_period(MONSTER_PERIOD);
 
-      // Check for teleporter
-      int newX, newY;
-      int teleporter_idx = -1;
-      for (int i = 0; i < Num_teleporters; i++) {
-        if ((teleporters[i].x1 == current.x &&
-             teleporters[i].y1 == current.y) ||
-            (teleporters[i].x2 == current.x &&
-             teleporters[i].y2 == current.y)) {
-          teleporter_idx = i;
-          break;
-        }
-      }
-      if (!players[p].justTeleported && teleporter_idx >= 0 &&
-          check_teleporter(current.x, current.y, &newX, &newY)) {
-
-        // Record teleportation
-        players[p].justTeleported = Game_moves + 2;
-
-        Position teleported = {newX, newY, current.x, current.y};
-        push_stack(&stacks[p], teleported);
-        parent_map[p][newY][newX].x = current.x;
-        parent_map[p][newY][newX].y = current.y;
-
-        // Mark destination as visited
-        maze->visited[p][newY][newX] = 1;
-
-        // Visualize teleportation
-        for (int i = 0; i < 5; i++) { // Flicker for 3 cycles
-            mvprintw(newY, newX, TELEPORTER_CHAR);             
-            mvprintw(current.y, current.x, TELEPORTER_CHAR);   
-            wnoutrefresh(stdscr);
-            mysleep((int) (pauseTime/40));           // Short delay (50ms)
-        
-            attron(A_REVERSE);
-            mvprintw(newY, newX, TELEPORTER_CHAR);            
-            mvprintw(current.y, current.x, TELEPORTER_CHAR);  
-            attroff(A_REVERSE);
-            wnoutrefresh(stdscr);
-            mysleep((int) (pauseTime/40));            // Another delay
-        }        
-        continue;
-      }
+    // Not defeated initially
+    monsters.defeated[i] = 0;
 
-      // Check for monster
-      int monster_idx = check_monster(current.x, current.y);
-      if (monster_idx > 0) {
-        monster_idx--; // Adjust index (monster_idx was returned +1)
-        int battle_result = battle_bot_monster(monster_idx, player_id);
-
-        if (battle_result == 0) {
-          // Player lost battle, mark position as visited in player's array
-          maze->visited[p][current.y][current.x] = 1;
-
-          // Also update the visualization
-          char visited_char = get_player_visited_char(player_id);
-          if (
-              maze->grid[current.y][current.x] != END1 &&
-              maze->grid[current.y][current.x] != END2 &&
-              maze->grid[current.y][current.x] != END3 &&
-              maze->grid[current.y][current.x] != END4 &&
-              maze->grid[current.y][current.x] != TELEPORTER) {
-            maze->grid[current.y][current.x] = visited_char;
-          }
+    // Name from the shuffled list, numbered once the list runs out
+    if (i < NUM_MONSTER_NAMES) {
+      snprintf(monsters.info[i].name, sizeof(monsters.info[i].name), "%s",
+               MONSTER_NAMES_R[i]);
+    } else {
+      snprintf(monsters.info[i].name, sizeof(monsters.info[i].name), "%-10.10s%5d",
+               MONSTER_NAMES_R[i % NUM_MONSTER_NAMES], (i + 1) % 100000);
+    }
+    add_monster_at(i);
+  }
+}
 
-          // Check if player has lost too many battles
-          if (players[p].battles_lost >= 3) {
-            players[p].abandoned_race = 2;
-            highlight_player_solution_path(p);
-            display_player_alert(player_id, -2);
+//////////////////////////////////////////////////////
+// Worker pool for the propose phase. parallel_for() hands each thread
+// (the caller included) a contiguous share of the items and returns once
+// all of them are done; small jobs just run inline
+
+// splitmix64 step, a tiny deterministic generator independent of rand()
+uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
 
-            // Clear the stack to stop the player's exploration
-            clear_stack(&stacks[p]);
-          }
+// Run thread t's share [t*n/nt, (t+1)*n/nt) of the current job
+static void run_share(int t) {
+  int nt = (int) Pool_threads.size() + 1;
+  int lo = (int) ((long) t * Pool_items / nt);
+  int hi = (int) ((long) (t + 1) * Pool_items / nt);
+  for (int i = lo; i < hi; i++) {
+    Pool_job(i);
+  }
+}
 
-          continue;
-        } else if (battle_result < 0) {
-          ; // no battle took place
-        }
-      }
+void pool_worker(int t) {
+  unsigned seen = 0;
+  for (;;) {
+    std::unique_lock<std::mutex> lock(Pool_lock);
+    Pool_wake.wait(lock, [&] { return Pool_quit || Pool_generation != seen; });
+    if (Pool_quit)
+      return;
+    seen = Pool_generation;
+    lock.unlock();
 
-      // Mark as visited in player's separate visited array
-      maze->visited[p][current.y][current.x] = 1;
+    run_share(t);
 
-      // Also update the visualization in the shared grid
-      char visited_char = get_player_visited_char(player_id);
-      if (
-          maze->grid[current.y][current.x] != END1 &&
-          maze->grid[current.y][current.x] != END2 &&
-          maze->grid[current.y][current.x] != END3 &&
-          maze->grid[current.y][current.x] != END4 &&
-          maze->grid[current.y][current.x] != TELEPORTER &&
-          maze->grid[current.y][current.x] != MONSTER &&
-          maze->grid[current.y][current.x] != DEFEATED_MONSTER) {
-        maze->grid[current.y][current.x] = visited_char;
-      }
+    lock.lock();
+    if (--Pool_busy == 0)
+      Pool_done.notify_one();
+  }
+}
 
-      // start Try all possible directions using player-specific direction arrays
-      for (int i = 0; i < 4; i++) {
-        int dir_idx = i;
-        int nextX = current.x + players[p].dx[dir_idx];
-        int nextY = current.y + players[p].dy[dir_idx];
+void start_pool() {
+  if (Num_threads < 1) {
+    unsigned hw = std::thread::hardware_concurrency();
+    Num_threads = hw ? (int) MIN(hw, (unsigned) DEF_MAX_THREADS) : 1;
+  }
+  Num_threads = MIN(Num_threads, MAX_THREADS);
+  for (int t = 1; t < Num_threads; t++) {
+    Pool_threads.emplace_back(pool_worker, t);
+  }
+}
 
-        // Don't go back to parent
-        if (nextX == current.parentX && nextY == current.parentY) {
-          continue;
-        }
+void stop_pool() {
+  {
+    std::lock_guard<std::mutex> lock(Pool_lock);
+    Pool_quit = 1;
+  }
+  Pool_wake.notify_all();
+  for (std::thread &t : Pool_threads) {
+    t.join();
+  }
+  Pool_threads.clear();
+}
 
-        if (nextX >= 0 && nextX < maze->cols && nextY >= 0 &&
-            nextY < maze->rows) {
-          char cell = maze->grid[nextY][nextX];
+void parallel_for(int n, void (*job)(int)) {
+  if (Pool_threads.empty() || n < PARALLEL_MIN_ITEMS) {
+    for (int i = 0; i < n; i++) {
+      job(i);
+    }
+    return;
+  }
 
-          // Allow exploring if not a wall and not visited by THIS player
-          if (cell != WALL && maze->visited[p][nextY][nextX] == 0) {
-            maze->visited[p][nextY][nextX] =
-                1; // Mark as visited for this player
+  {
+    std::lock_guard<std::mutex> lock(Pool_lock);
+    Pool_job = job;
+    Pool_items = n;
+    Pool_busy = (int) Pool_threads.size();
+    Pool_generation++;
+  }
+  Pool_wake.notify_all();
 
-            Position nextPos = {nextX, nextY, current.x, current.y};
-            push_stack(&stacks[p], nextPos);
-            parent_map[p][nextY][nextX].x = current.x;
-            parent_map[p][nextY][nextX].y = current.y;
-          }
-        }
-      }
-      // end Try all possible directions
-    }
-    // end Rotate through players
-    //////////////////////////////////////////
+  run_share(0);
 
-    // Update monsters occasionally
-    if (Game_moves % 5 == 0) {
-      update_monsters();
-    }
+  std::unique_lock<std::mutex> lock(Pool_lock);
+  Pool_done.wait(lock, [] { return Pool_busy == 0; });
+}
+// end Worker pool
+//////////////////////////////////////////////////////
 
-    // Visualize exploration after each player's move
-    print_maze();
-    display_player_stats();
-    read_keyboard();
-    if (LastSLupdate && LastSLupdate+25 < Game_moves) {
-      move(maze->rows + 5, 0);
-      wclrtoeol(stdscr);
-    }
-    mysleep(Game_delay);    
+//////////////////////////////////////////////////////
+// Two-phase tick. Every tick first runs a propose phase in which each bot
+// picks its next cell from its own stack without touching shared state (so
+// bots can propose in parallel), then a resolve phase on the main thread
+// that applies all moves at once and settles battles, goals, teleporters
+// and monsters in a per-tick shuffled order, so no bot index is favoured
+
+// Deterministic per-tick resolve order, a shuffle seeded by the tick number
+// (independent of rand() so the order never depends on earlier battles)
+void make_tick_order() {
+  int n = Num_players;
+  uint64_t state = (uint64_t) Game_time * 0x9E3779B97F4A7C15ull + 1;
+
+  Tick_order.resize(n);
+  Tick_rank.resize(n);
+  for (int i = 0; i < n; i++) {
+    Tick_order[i] = i;
+  }
+  for (int i = n - 1; i > 0; i--) {
+    int j = (int) (splitmix64(&state) % (uint64_t) (i + 1));
+    std::swap(Tick_order[i], Tick_order[j]);
+  }
+  for (int i = 0; i < n; i++) {
+    Tick_rank[Tick_order[i]] = i;
+  }
+}
 
-    // Update game moves
-    Game_moves++;
-    for (int i = 0; i < NUM_PLAYERS; i++) {
-      // prevent teleport loops
-      if (players[i].justTeleported < Game_moves)
-        players[i].justTeleported = 0;
-      // decrement recovery_turns
-      if (players[i].recovery_turns)
-        players[i].recovery_turns--;
-    }
+// Open cell a bot may step onto (monsters and teleporters included)
+static inline int is_open(int x, int y) {
+  return x >= 0 && x < maze->cols && y >= 0 && y < maze->rows &&
+         maze->grid[y][x] != WALL;
+}
 
-    // Check for window resize
-    if (1) {
-      struct winsize size;
+// Manhattan distance from a cell to the bot's goal
+static inline int goal_distance(int p, int x, int y) {
+  return abs(players.info[p].end.x - x) + abs(players.info[p].end.y - y);
+}
 
-      ioctl(STDOUT_FILENO, TIOCGWINSZ, &size); // Get new size
+// Exact moves from a cell to the bot's goal (its distance field), -1 if
+// the goal can't be reached from there. Only the nodes' distances are
+// kept, a corridor cell takes the nearer of its corridor's two ends
+static inline int goal_moves(int p, int x, int y) {
+  const JunctionGraph *g = &Junctions;
+  const int *node_dist = &Node_dist[(size_t) p * (size_t) g->num_nodes];
+  int n = maze->node_at[y][x];
+  if (n >= 0) {
+    return node_dist[n];
+  }
+  size_t cell = (size_t) y * (size_t) maze->cols + (size_t) x;
+  int c = g->cell_corridor[cell];
+  if (c < 0) {
+    return -1; // a wall
+  }
+  int i = g->cell_step[cell];
+  int len = g->corridor_first[c + 1] - g->corridor_first[c] + 1; // a to b
+  int from_a = node_dist[g->corridor_a[c]];
+  int from_b = node_dist[g->corridor_b[c]];
+  int here = from_a < 0 ? -1 : from_a + i;
+  if (from_b >= 0 && (here < 0 || from_b + len - i < here)) {
+    here = from_b + len - i;
+  }
+  return here;
+}
+
+// Record the cell a walking bot is about to enter on its trail, the first
+// visit wins so the trail stays a tree rooted at the start. 1 if this was
+// the first visit, for unwalk_trail
+static inline int walk_trail(int p, Position next) {
+  if (trail_at(p, next.x, next.y) != TRAIL_NONE) {
+    return 0;
+  }
+  set_trail(p, next.x, next.y, next.parentX, next.parentY);
+  return 1;
+}
+
+// Take back walk_trail's record of a cell the bot was beaten back from:
+// it never got there
+static inline void unwalk_trail(int p, Position next, int fresh) {
+  if (fresh) {
+    put_trail(p, next.x, next.y, TRAIL_NONE);
+  }
+}
+
+// Number of open neighbours of a cell
+static inline int open_exits(int x, int y) {
+  int n = 0;
+  for (int d = 0; d < 4; d++) {
+    n += is_open(x + Base_dx[d], y + Base_dy[d]);
+  }
+  return n;
+}
+
+// Distance field of bot p: the fewest moves from every cell to the bot's
+// goal, -1 where the goal can't be reached. Neighbours are one move apart
+// and so are the two ends of a teleporter. Rather than a breadth-first
+// search over every cell, the goal's distance to each junction graph node
+// comes from Dijkstra over the corridors (with a bucket per distance, the
+// lengths being small whole numbers); goal_moves() works out the
+// corridor cells from their ends, so a bot's field is a node array, not a
+// plane of the maze
+void compute_distance_field(int p) {
+  static thread_local std::vector<std::vector<int>> buckets;
+  JunctionGraph *g = &Junctions;
+  int *node_dist = &Node_dist[(size_t) p * (size_t) g->num_nodes];
+  int span = g->max_length + 1; // buckets a node can be queued ahead
+
+  std::fill(node_dist, node_dist + g->num_nodes, -1);
+  buckets.resize((size_t) span);
+  Position goal = players.info[p].end;
+  node_dist[maze->node_at[goal.y][goal.x]] = 0;
+  buckets[0].push_back(maze->node_at[goal.y][goal.x]);
+  for (int d = 0, queued = 1; queued > 0; d++) {
+    std::vector<int> &bucket = buckets[(size_t) (d % span)];
+    for (size_t k = 0; k < bucket.size(); k++) {
+      int n = bucket[k];
+      queued--;
+      if (node_dist[n] != d) {
+        continue; // already reached by a shorter way
+      }
+      for (int i = n * 4; i < n * 4 + 5; i++) {
+        // the four corridors, then the teleporter jump
+        int to = i < n * 4 + 4 ? g->to[i] : g->jump[n];
+        int to_dist = d + (i < n * 4 + 4 ? g->length[i] : 1);
+        if (to >= 0 && (node_dist[to] < 0 || to_dist < node_dist[to])) {
+          node_dist[to] = to_dist;
+          buckets[(size_t) (to_dist % span)].push_back(to);
+          queued++;
+        }
+      }
+    }
+    bucket.clear();
+  }
+  players.optimal[p] = goal_moves(p, players.info[p].start.x,
+                                  players.info[p].start.y);
+}
+
+// Build the round's junction graph. Nodes are the cells that are not
+// plain corridor: junctions, dead ends, starts, goals and teleporters.
+// From every node each open direction leads down a corridor of cells with
+// exactly two exits to the next node; the edge keeps the far node and the
+// corridor length. Built once per round after the teleporters are placed
+void build_junction_graph() {
+  JunctionGraph *g = &Junctions;
+  int rows = maze->rows, cols = maze->cols;
+
+  g->x.clear();
+  g->y.clear();
+  g->open_cells = 0;
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < cols; x++) {
+      maze->node_at[y][x] = -1;
+      if (maze->grid[y][x] == WALL) {
+        continue;
+      }
+      g->open_cells++;
+      Cell c = maze->grid[y][x];
+      if (open_exits(x, y) != 2 || c == TELEPORTER || is_end_cell(c)) {
+        maze->node_at[y][x] = (int) g->x.size();
+        g->x.push_back(x);
+        g->y.push_back(y);
+      }
+    }
+  }
+  // starts are nodes too, so a corridor walk never runs past one
+  for (int p = 0; p < Num_players; p++) {
+    Position s = players.info[p].start;
+    if (maze->node_at[s.y][s.x] < 0) {
+      maze->node_at[s.y][s.x] = (int) g->x.size();
+      g->x.push_back(s.x);
+      g->y.push_back(s.y);
+    }
+  }
+  g->num_nodes = (int) g->x.size();
+  g->jump.assign(g->num_nodes, -1);
+  for (int n = 0; n < g->num_nodes; n++) {
+    int tx, ty;
+    if (maze->grid[g->y[n]][g->x[n]] == TELEPORTER &&
+        check_teleporter(g->x[n], g->y[n], &tx, &ty)) {
+      g->jump[n] = maze->node_at[ty][tx];
+    }
+  }
+
+  // Walk each corridor from each end, keeping its cells in order from
+  // one end (the lower node and direction)
+  g->to.assign((size_t) g->num_nodes * 4, -1);
+  g->length.assign((size_t) g->num_nodes * 4, 0);
+  g->corridor_a.clear();
+  g->corridor_b.clear();
+  g->corridor_first.assign(1, 0);
+  g->cells.clear();
+  g->cell_corridor.assign((size_t) rows * (size_t) cols, -1);
+  g->cell_step.assign((size_t) rows * (size_t) cols, -1);
+  for (int n = 0; n < g->num_nodes; n++) {
+    for (int d = 0; d < 4; d++) {
+      int px = g->x[n], py = g->y[n];
+      int x = px + Base_dx[d], y = py + Base_dy[d];
+      if (!is_open(x, y)) {
+        continue;
+      }
+      int len = 1;
+      size_t first = g->cells.size();
+      // a loop of corridor with no node on it can't occur when connected
+      // to a node, but guard the walk anyway
+      while (maze->node_at[y][x] < 0 && len <= rows * cols) {
+        int nx = -1, ny = -1;
+        g->cells.push_back((unsigned) y << 16 | (unsigned) x);
+        for (int e = 0; e < 4; e++) {
+          int cx = x + Base_dx[e], cy = y + Base_dy[e];
+          if (is_open(cx, cy) && !(cx == px && cy == py)) {
+            nx = cx;
+            ny = cy;
+            break;
+          }
+        }
+        px = x;
+        py = y;
+        x = nx;
+        y = ny;
+        len++;
+      }
+      int to = maze->node_at[y][x];
+      g->to[(size_t) n * 4 + (size_t) d] = to;
+      g->length[(size_t) n * 4 + (size_t) d] = len;
+
+      // keep the cells from the walk that starts at the lower end only
+      int back = 0;
+      while (x + Base_dx[back] != px || y + Base_dy[back] != py) {
+        back++;
+      }
+      if (n < to || (n == to && d < back)) {
+        for (size_t i = first; i < g->cells.size(); i++) {
+          size_t cell = (size_t) (g->cells[i] >> 16) * (size_t) cols +
+                        (g->cells[i] & 0xffff);
+          g->cell_corridor[cell] = (int) g->corridor_a.size();
+          g->cell_step[cell] = (int) (i - first) + 1;
+        }
+        g->corridor_a.push_back(n);
+        g->corridor_b.push_back(to);
+        g->corridor_first.push_back((int) g->cells.size());
+      } else {
+        g->cells.resize(first);
+      }
+    }
+  }
+  g->num_edges = (int) g->corridor_a.size();
+  g->max_length = 1;
+  for (int len : g->length) {
+    g->max_length = std::max(g->max_length, len);
+  }
+}
+
+// Moves between two boxes, at least
+static inline int span_gap(const LeapSpan *a, const LeapSpan *b) {
+  return std::max({0, a->x0 - b->x1, b->x0 - a->x1}) +
+         std::max({0, a->y0 - b->y1, b->y0 - a->y1});
+}
+
+static inline LeapSpan cell_span(int x, int y) {
+  return LeapSpan{x, y, x, y, 0};
+}
+
+// The LEAP_BLOCK a cell is in
+static inline int block_of(int x, int y) {
+  return (y / LEAP_BLOCK) * Block_cols + x / LEAP_BLOCK;
+}
+
+// Whether any block within reach of a box is set in a per-block count
+template <typename T>
+static inline int blocks_near(const T *counts, const LeapSpan *a, int reach) {
+  int bx0 = std::max(a->x0 - reach, 0) / LEAP_BLOCK;
+  int by0 = std::max(a->y0 - reach, 0) / LEAP_BLOCK;
+  int bx1 = std::min(a->x1 + reach, maze->cols - 1) / LEAP_BLOCK;
+  int by1 = std::min(a->y1 + reach, maze->rows - 1) / LEAP_BLOCK;
+  for (int by = by0; by <= by1; by++) {
+    for (int bx = bx0; bx <= bx1; bx++) {
+      if (counts[by * Block_cols + bx]) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+// With --corridors, count a cell into or out of best-first bot p's queue,
+// the cells it may jump to
+__attribute__((no_instrument_function)) static inline
+void note_frontier(int p, int x, int y, int delta) {
+  if (!Frontier.empty()) {
+    uint16_t *n = &Frontier[(size_t) p * (size_t) Num_blocks + (size_t) block_of(x, y)];
+    *n = (uint16_t) (*n + delta);
+  }
+}
+
+// Whether bot q could get onto a box within reach - 1 moves: it walks a
+// cell a move from where it stands or is about to, from anywhere in a
+// corridor it is leaping, or from a cell it jumps to. Depth first that is
+// one of the top cells of its stack, a cell a move; best first anything
+// queued
+int bot_near(int q, const LeapSpan *a, int reach) {
+  LeapSpan at = cell_span(players.current[q].x, players.current[q].y);
+  if (span_gap(a, &at) <= reach ||
+      (Bot_leap[q].until > Game_time && span_gap(a, &Bot_leap[q]) <= reach)) {
+    return 1;
+  }
+  if (Bot_due[q] && Bot_move[q].x >= 0) {
+    at = cell_span(Bot_move[q].x, Bot_move[q].y);
+    if (span_gap(a, &at) <= reach) {
+      return 1;
+    }
+  }
+  switch (players.info[q].strategy) {
+  case STRAT_DFS: {
+    int n = 0;
+    for (Node *e = Bot_stacks[q]; e && n < reach; e = e->next, n++) {
+      at = cell_span(e->pos.x, e->pos.y);
+      if (span_gap(a, &at) <= reach) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  case STRAT_GREEDY:
+  case STRAT_ASTAR:
+    return blocks_near(&Frontier[(size_t) q * (size_t) Num_blocks], a, reach);
+  default: // the walkers don't jump
+    return 0;
+  }
+}
+
+// Whether bot p may stand for walking the len cells of span one a period:
+// nothing else can come close enough to tell. A monster moves a cell a
+// period, so one farther than it can go meanwhile, plus a cell for a step
+// it might try onto the corridor, can't meet the bot there, fight it or be
+// turned back by its trail; a pursuing one also smells the bot from
+// PURSUIT_RADIUS away. Other bots are held to the same, counting their
+// jumps (see bot_near) and the teleporters that lead next to the corridor
+int leap_clear(int p, const LeapSpan *span, int len) {
+  int window = len * players.period[p];
+  int smell = Monster_pursuit ? PURSUIT_RADIUS : 0;
+
+  for (int m = 0; m < Num_monsters; m++) {
+    LeapSpan at = cell_span(monsters.x[m], monsters.y[m]);
+    if (!monsters.defeated[m] &&
+        span_gap(span, &at) <= window / monsters.period[m] + 2 + smell) {
+      return 0;
+    }
+  }
+
+  for (int q = 0; q < Num_players; q++) {
+    if (q != p && !players.reached_goal[q] && !players.abandoned_race[q] &&
+        bot_near(q, span, window / players.period[q] + 2)) {
+      return 0;
+    }
+  }
+
+  // a teleporter next to the corridor brings the bots near its other end
+  int reach = window / Min_bot_period + 2;
+  if (!blocks_near(Block_teleporters.data(), span, reach)) {
+    return 1;
+  }
+  for (int i = 0; i < Num_teleporters; i++) {
+    LeapSpan end1 = cell_span(teleporters[i].x1, teleporters[i].y1);
+    LeapSpan end2 = cell_span(teleporters[i].x2, teleporters[i].y2);
+    int gap1 = span_gap(span, &end1), gap2 = span_gap(span, &end2);
+    if (gap1 > reach && gap2 > reach) {
+      continue;
+    }
+    for (int q = 0; q < Num_players; q++) {
+      if (q == p || players.reached_goal[q] || players.abandoned_race[q]) {
+        continue;
+      }
+      int reach_q = window / players.period[q] + 2;
+      if ((gap1 <= reach_q && bot_near(q, &end2, reach_q)) ||
+          (gap2 <= reach_q && bot_near(q, &end1, reach_q))) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+// Headless corridor leap for a bot about to step onto pos: if pos is a
+// corridor cell, carry on down the corridor in the same step, marking the
+// trail, and stop on the next node, before a cell the bot has already
+// visited (where per-cell DFS would dead end) or before a teleporter or
+// its goal (both act on arrival, which a leap would move earlier). The
+// leap goes only as far as leap_clear() allows, so the game plays out as
+// it would cell by cell. Called in the resolve phase, in tick order, so
+// each leap sees the ones before it. Returns the number of cells moved,
+// pos becomes the landing cell
+int corridor_leap(int p, Position *pos) {
+  static std::vector<Position> walk;
+  int x = pos->x, y = pos->y;
+  int px = pos->parentX, py = pos->parentY;
+
+  // only a step into a corridor from a neighbouring cell can be followed
+  if (maze->node_at[y][x] >= 0 || maze->monster_at[y][x] ||
+      abs(px - x) + abs(py - y) != 1) {
+    return 1;
+  }
+  walk.assign(1, *pos);
+  for (;;) {
+    int nx = -1, ny = -1;
+    for (int d = 0; d < 4; d++) {
+      int cx = x + Base_dx[d], cy = y + Base_dy[d];
+      if (is_open(cx, cy) && !(cx == px && cy == py)) {
+        nx = cx;
+        ny = cy;
+        break;
+      }
+    }
+    if (nx < 0 || trail_at(p, nx, ny) != TRAIL_NONE ||
+        maze->grid[ny][nx] == TELEPORTER ||
+        (nx == players.info[p].end.x && ny == players.info[p].end.y)) {
+      break;
+    }
+    walk.push_back(Position{nx, ny, x, y});
+    px = x;
+    py = y;
+    x = nx;
+    y = ny;
+    if (maze->node_at[y][x] >= 0 || maze->monster_at[y][x]) {
+      break;
+    }
+  }
+
+  // a leap that isn't clear isn't clear when longer either, and most are
+  // clear all the way
+  int len = 1, most = (int) walk.size();
+  for (int first = 1; len < most; first = 0) {
+    int mid = first ? most : (len + most + 1) / 2;
+    LeapSpan span = cell_span(walk[0].x, walk[0].y);
+    for (int i = 1; i < mid; i++) {
+      span.x0 = std::min(span.x0, walk[i].x);
+      span.y0 = std::min(span.y0, walk[i].y);
+      span.x1 = std::max(span.x1, walk[i].x);
+      span.y1 = std::max(span.y1, walk[i].y);
+    }
+    if (leap_clear(p, &span, mid)) {
+      len = mid;
+    } else {
+      most = mid - 1;
+    }
+  }
+  LeapSpan *span = &Bot_leap[p];
+  *span = cell_span(walk[0].x, walk[0].y);
+  span->until = Game_time + len * players.period[p];
+  for (int i = 1; i < len; i++) {
+    set_trail(p, walk[i].x, walk[i].y, walk[i].parentX, walk[i].parentY);
+    span->x0 = std::min(span->x0, walk[i].x);
+    span->y0 = std::min(span->y0, walk[i].y);
+    span->x1 = std::max(span->x1, walk[i].x);
+    span->y1 = std::max(span->y1, walk[i].y);
+  }
+  *pos = walk[len - 1];
+  return len;
+}
+
+// Mark the corridor cells a leap passed over (all but the landing cell)
+// as visited on the shared grid
+void mark_corridor(int p, Position landing, int len) {
+  int x = landing.x, y = landing.y;
+  Cell visited_char = get_player_visited_char(p + 1);
+
+  for (int i = 1; i < len && trail_parent(p, &x, &y); i++) {
+    Cell c = maze->grid[y][x];
+    if (!is_end_cell(c) && c != TELEPORTER && c != MONSTER &&
+        c != DEFEATED_MONSTER) {
+      set_cell(x, y, visited_char);
+    }
+  }
+}
+
+// Push the unexplored neighbours of a cell onto the bot's stack, using the
+// bot's own direction preferences
+void expand_bot(int p, Position current) {
+  players.expanded[p]++;
+  for (int i = 0; i < 4; i++) {
+    int nextX = current.x + players.info[p].dx[i];
+    int nextY = current.y + players.info[p].dy[i];
+
+    // Don't go back to parent
+    if (nextX == current.parentX && nextY == current.parentY) {
+      continue;
+    }
+
+    // Allow exploring if not a wall and not visited by THIS player
+    if (is_open(nextX, nextY) &&
+        trail_at(p, nextX, nextY) == TRAIL_NONE) {
+      // Mark as visited for this player
+      set_trail(p, nextX, nextY, current.x, current.y);
+
+      Position nextPos = {nextX, nextY, current.x, current.y};
+      push_stack(&Bot_stacks[p], nextPos);
+    }
+  }
+}
+
+// Depth-first bookkeeping for the outcome of the last move: expand where
+// the bot settled, retry a contested cell, go through a teleporter next
+void dfs_outcome(int p) {
+  Outcome *out = &Bot_outcome[p];
+
+  switch (out->kind) {
+  case OUTCOME_SETTLED:
+    expand_bot(p, out->cell);
+    break;
+  case OUTCOME_RETREATED:
+  case OUTCOME_TELEPORTED:
+    push_stack(&Bot_stacks[p], out->cell);
+    break;
+  default: // lost to a monster: this branch is given up
+    break;
+  }
+  out->kind = OUTCOME_NONE;
+}
+
+// Depth-first controller: yield the top of the stack, then act on what
+// the resolve phase made of the move before picking again. The jumps back
+// up the tree are what make DFS cheap on CPU but dear in moves
+BotTask dfs_bot(int p) {
+  while (!is_empty(Bot_stacks[p])) {
+    Position next = pop_stack(&Bot_stacks[p]);
+    co_yield next;
+    dfs_outcome(p);
+  }
+}
+
+// Right-hand wall follower: walks cell by cell keeping a wall on its
+// right. Gives up when it finds itself in the same cell facing the same
+// way twice, which only happens when circling a loop or island. The
+// headings a cell was left by are its marks, put once the bot has left
+BotTask wall_follower_bot(int p) {
+  Position at = players.info[p].start;
+  int heading = 0;
+
+  // start facing the bot's preferred direction
+  for (int d = 0; d < 4; d++) {
+    if (Base_dx[d] == players.info[p].dx[0] &&
+        Base_dy[d] == players.info[p].dy[0]) {
+      heading = d;
+    }
+  }
+  co_yield at;
+
+  for (;;) {
+    if (marks_at(p, at.x, at.y) & (1 << heading)) {
+      co_return;
+    }
+
+    // right, straight on, left, back
+    players.expanded[p]++;
+    int dir = -1;
+    for (int turn : {1, 0, 3, 2}) {
+      int d = (heading + turn) % 4;
+      if (is_open(at.x + Base_dx[d], at.y + Base_dy[d])) {
+        dir = d;
+        break;
+      }
+    }
+    if (dir < 0) {
+      co_return; // walled in
+    }
+
+    Position next = {at.x + Base_dx[dir], at.y + Base_dy[dir], at.x, at.y};
+    int fresh = walk_trail(p, next);
+    co_yield next;
+
+    // a retreat leaves the bot where it was, so it just tries again
+    Outcome out = Bot_outcome[p];
+    if (out.kind == OUTCOME_RETREATED) {
+      unwalk_trail(p, next, fresh);
+      continue;
+    }
+    put_marks(p, at.x, at.y, marks_at(p, at.x, at.y) | 1 << heading);
+    at = next;
+    heading = dir;
+    if (out.kind == OUTCOME_TELEPORTED) {
+      // step out at the far end, keeping the heading
+      Position far = out.cell;
+      co_yield far;
+      if (Bot_outcome[p].kind != OUTCOME_RETREATED) {
+        at = far;
+      }
+    }
+  }
+}
+
+// Trémaux passage marks are kept with the cell on the left of or above the
+// passage, two bits for the passage right of it and two for the one below,
+// so a passage has one count whichever end it is seen from
+static inline int passage_marks(int p, Position at, int dir) {
+  int x = at.x - (dir == 3), y = at.y - (dir == 0);
+  int shift = (dir & 1) ? 0 : 2;
+  return (marks_at(p, x, y) >> shift) & 3;
+}
+
+static inline void mark_passage(int p, Position at, int dir) {
+  int x = at.x - (dir == 3), y = at.y - (dir == 0);
+  int shift = (dir & 1) ? 0 : 2;
+  put_marks(p, x, y, marks_at(p, x, y) + (1 << shift));
+}
+
+// Trémaux's algorithm: every passage (pair of neighbouring cells) is
+// marked each time it is walked. Take unmarked passages first, turn back
+// on reaching a visited cell through a fresh passage, never walk one
+// twice. Explores everything reachable with each passage walked at most
+// twice and gives up when only twice-walked passages are left
+BotTask tremaux_bot(int p) {
+  Position at = players.info[p].start;
+  int from = -1; // direction back to where the bot came from
+  int old_cell = 0;
+  int pref[4];   // the bot's preferred directions as Base_dx/dy indexes
+
+  for (int i = 0; i < 4; i++) {
+    for (int d = 0; d < 4; d++) {
+      if (Base_dx[d] == players.info[p].dx[i] &&
+          Base_dy[d] == players.info[p].dy[i]) {
+        pref[i] = d;
+      }
+    }
+  }
+  co_yield at;
+
+  for (;;) {
+    int dir = -1;
+
+    players.expanded[p]++;
+    if (old_cell && from >= 0 && passage_marks(p, at, from) == 1) {
+      dir = from; // been here before: turn back
+    } else {
+      // fewest marks wins, in the bot's preferred order
+      int best = 2;
+      for (int i = 0; i < 4; i++) {
+        int d = pref[i];
+        if (!is_open(at.x + Base_dx[d], at.y + Base_dy[d])) {
+          continue;
+        }
+        int count = passage_marks(p, at, d);
+        if (count < best) {
+          best = count;
+          dir = d;
+        }
+      }
+    }
+    if (dir < 0) {
+      co_return; // every passage walked twice
+    }
+
+    Position next = {at.x + Base_dx[dir], at.y + Base_dy[dir], at.x, at.y};
+    int fresh = walk_trail(p, next);
+    co_yield next;
+
+    // a retreat leaves the bot where it was, old_cell and all
+    Outcome out = Bot_outcome[p];
+    if (out.kind == OUTCOME_RETREATED) {
+      unwalk_trail(p, next, fresh);
+    } else {
+      if (passage_marks(p, at, dir) < 2) {
+        mark_passage(p, at, dir);
+      }
+      old_cell = !fresh;
+      at = next;
+      from = (dir + 2) % 4;
+    }
+    if (out.kind == OUTCOME_TELEPORTED) {
+      // arrive at the far end with no passage behind
+      Position far = out.cell;
+      co_yield far;
+      if (Bot_outcome[p].kind != OUTCOME_RETREATED) {
+        at = far;
+        from = -1;
+      }
+    }
+  }
+}
+
+// Best-first controllers share one frontier: greedy orders it by the
+// distance to the goal, A* by the path length so far plus that distance.
+// Cells are closed when first queued (the trail plane), so no per-bot
+// cost plane is needed; like DFS the bot jumps to whichever cell is next
+BotTask best_first_bot(int p, int astar) {
+  struct Item {
+    int f, g, seq;
+    Position pos;
+  };
+  struct Later {
+    bool operator()(const Item &a, const Item &b) const {
+      // newest first on ties, so equal-cost runs are followed through
+      return a.f != b.f ? a.f > b.f : a.seq < b.seq;
+    }
+  };
+  std::priority_queue<Item, std::vector<Item>, Later> open;
+  Position start = players.info[p].start;
+  int seq = 0;
+
+  open.push(Item{goal_distance(p, start.x, start.y), 0, seq++, start});
+  note_frontier(p, start.x, start.y, 1);
+  while (!open.empty()) {
+    Item it = open.top();
+    open.pop();
+    note_frontier(p, it.pos.x, it.pos.y, -1);
+    co_yield it.pos;
+
+    Outcome out = Bot_outcome[p];
+    if (out.kind == OUTCOME_RETREATED) {
+      open.push(Item{it.f, it.g, seq++, it.pos});
+      note_frontier(p, it.pos.x, it.pos.y, 1);
+    } else if (out.kind == OUTCOME_TELEPORTED) {
+      Position far = out.cell;
+      int g = it.g + 1;
+      open.push(Item{(astar ? g : 0) + goal_distance(p, far.x, far.y), g,
+                     seq++, far});
+      note_frontier(p, far.x, far.y, 1);
+    } else if (out.kind == OUTCOME_SETTLED) {
+      players.expanded[p]++;
+      for (int i = 0; i < 4; i++) {
+        int nextX = it.pos.x + players.info[p].dx[i];
+        int nextY = it.pos.y + players.info[p].dy[i];
+        if (is_open(nextX, nextY) &&
+            trail_at(p, nextX, nextY) == TRAIL_NONE) {
+          set_trail(p, nextX, nextY, it.pos.x, it.pos.y);
+          int g = it.g + 1;
+          Position next = {nextX, nextY, it.pos.x, it.pos.y};
+          open.push(Item{(astar ? g : 0) + goal_distance(p, nextX, nextY), g,
+                         seq++, next});
+          note_frontier(p, nextX, nextY, 1);
+        }
+      }
+    }
+  }
+}
+
+// Oracle: walks straight down its distance field, always to the neighbour
+// closest to the goal. Sets the pace a perfect solver would, so its moves
+// only exceed the optimum through battles and teleporter cooldowns
+BotTask oracle_bot(int p) {
+  co_yield players.info[p].start;
+
+  for (;;) {
+    Position at = players.current[p];
+    int best = -1, dir = -1;
+
+    players.expanded[p]++;
+    for (int i = 0; i < 4; i++) {
+      int d = -1;
+      for (int k = 0; k < 4; k++) {
+        if (Base_dx[k] == players.info[p].dx[i] &&
+            Base_dy[k] == players.info[p].dy[i]) {
+          d = k;
+        }
+      }
+      int nx = at.x + Base_dx[d], ny = at.y + Base_dy[d];
+      if (is_open(nx, ny) && goal_moves(p, nx, ny) >= 0 &&
+          (best < 0 || goal_moves(p, nx, ny) < best)) {
+        best = goal_moves(p, nx, ny);
+        dir = d;
+      }
+    }
+    if (dir < 0) {
+      co_return; // walled in, or the goal is cut off
+    }
+
+    Position next = {at.x + Base_dx[dir], at.y + Base_dy[dir], at.x, at.y};
+    walk_trail(p, next);
+    co_yield next;
+    if (Bot_outcome[p].kind == OUTCOME_TELEPORTED) {
+      co_yield Bot_outcome[p].cell;
+    }
+  }
+}
+
+BotTask greedy_bot(int p) {
+  return best_first_bot(p, 0);
+}
+
+BotTask astar_bot(int p) {
+  return best_first_bot(p, 1);
+}
+
+// Controller for a bot's strategy
+BotTask start_controller(int p) {
+  switch (players.info[p].strategy) {
+  case STRAT_WALL:
+    return wall_follower_bot(p);
+  case STRAT_TREMAUX:
+    return tremaux_bot(p);
+  case STRAT_GREEDY:
+    return greedy_bot(p);
+  case STRAT_ASTAR:
+    return astar_bot(p);
+  case STRAT_ORACLE:
+    return oracle_bot(p);
+  default:
+    return dfs_bot(p);
+  }
+}
+
+// Propose phase for one bot: resume its controller for the next cell.
+// Controllers only write the bot's own state and trail plane and walls
+// never change during a round, so this is safe to run in parallel
+void propose_move(int p) {
+  Bot_move[p].x = -1;
+  Bot_length[p] = 1;
+  if (players.reached_goal[p] || players.abandoned_race[p])
+    return;
+
+  std::coroutine_handle<BotTask::promise_type> h = Bot_tasks[p].handle;
+  if (!h.done()) {
+    h.resume();
+    if (!h.done()) {
+      Bot_move[p] = h.promise().move;
+    }
+  }
+}
+
+// Propose for the i-th due bot, the parallel_for() job
+void propose_due(int i) {
+  if (Use_coroutines) {
+    propose_move(Due_bots[i]);
+  } else {
+    propose_move_direct(Due_bots[i]);
+  }
+}
+
+// The depth-first step written inline, kept as the --bench baseline
+void propose_move_direct(int p) {
+  Bot_move[p].x = -1;
+  Bot_length[p] = 1;
+  if (players.reached_goal[p] || players.abandoned_race[p])
+    return;
+
+  dfs_outcome(p);
+  if (!is_empty(Bot_stacks[p])) {
+    Bot_move[p] = pop_stack(&Bot_stacks[p]);
+  }
+}
+
+// Bot gives up after losing too many battles
+void check_battles_lost(int p) {
+  if (players.battles_lost[p] >= 3) {
+    players.abandoned_race[p] = 2;
+    highlight_player_solution_path(p);
+    display_player_alert(p + 1, -2);
+
+    // Clear the stack to stop the player's exploration
+    clear_stack(&Bot_stacks[p]);
+  }
+}
+
+// Loser of a bot battle falls back to the cell it came from; its
+// controller decides whether to try the contested cell again
+void retreat_bot(int p) {
+  Position contested = Bot_move[p];
+
+  Bot_move[p].x = -1; // nothing left to settle this time
+  Bot_outcome[p].kind = OUTCOME_RETREATED;
+  Bot_outcome[p].cell = contested;
+  Bot_retreats++;
+  if (contested.parentX != -1 && contested.parentY != -1) {
+    Position retreat = contested;
+    retreat.x = contested.parentX;
+    retreat.y = contested.parentY;
+    move_bot(p, retreat);
+  }
+  check_battles_lost(p);
+}
+
+// Bots sharing p's cell battle p one at a time, in tick order
+void resolve_collisions(int p) {
+  Position at = Bot_move[p];
+
+  Cell_bots.clear();
+  for (int b = maze->bot_at[at.y][at.x]; b; b = players.next_at[b - 1]) {
+    int q = b - 1;
+    if (q != p && !players.reached_goal[q] && !players.abandoned_race[q]) {
+      Cell_bots.push_back(q);
+    }
+  }
+  std::sort(Cell_bots.begin(), Cell_bots.end(),
+            [](int a, int b) { return Tick_rank[a] < Tick_rank[b]; });
+
+  for (int q : Cell_bots) {
+    // q may have been driven off by an earlier battle this tick
+    if (players.current[q].x != at.x || players.current[q].y != at.y)
+      continue;
+
+    int winner_id = battle_bots(p + 1, q + 1);
+    if (winner_id < 0) {
+      continue; // no battle took place
+    }
+    if (winner_id == p + 1) {
+      // only a bot that moved in this time can be driven back, one that
+      // was already standing here holds its cell
+      if (Bot_due[q] && Bot_move[q].x >= 0) {
+        retreat_bot(q);
+      }
+    } else {
+      retreat_bot(p);
+      break;
+    }
+  }
+}
+
+// Settle a bot on the cell it moved to: goal, teleporter, monster, trail
+void settle_bot(int p) {
+  int player_id = p + 1;
+  Position current = Bot_move[p];
+
+  // Check if reached the end
+  if (current.x == players.info[p].end.x && current.y == players.info[p].end.y) {
+    players.reached_goal[p] = 1;
+    Players_finished++;
+    players.finished_rank[p] = Players_finished;
+
+    // Mark as finished in UI
+    highlight_player_solution_path(p);
+    display_player_alert(player_id, players.finished_rank[p]);
+    return;
+  }
+
+  // Check for teleporter
+  int newX, newY;
+  int teleporter_idx = -1;
+  for (int i = 0; i < Num_teleporters; i++) {
+    if ((teleporters[i].x1 == current.x &&
+         teleporters[i].y1 == current.y) ||
+        (teleporters[i].x2 == current.x &&
+         teleporters[i].y2 == current.y)) {
+      teleporter_idx = i;
+      break;
+    }
+  }
+  if (players.teleport_until[p] <= Game_time && teleporter_idx >= 0 &&
+      check_teleporter(current.x, current.y, &newX, &newY)) {
+
+    // Record teleportation, no teleporting again for the next two moves
+    players.teleport_until[p] = Game_time + 3 * players.period[p];
+
+    Position teleported = {newX, newY, current.x, current.y};
+    Bot_outcome[p].kind = OUTCOME_TELEPORTED;
+    Bot_outcome[p].cell = teleported;
+
+    // Mark destination as visited, remembering where we came from
+    set_trail(p, newX, newY, current.x, current.y);
+
+    // Visualize teleportation, at the ends in view
+    int to_shown = in_view(newY, newX), from_shown = in_view(current.y, current.x);
+    if (!Headless && !Fast_forward && !Frame_cap && (to_shown || from_shown)) {
+      CursesLock lock(1);
+      int to_y = newY - View_y, to_x = newX - View_x;
+      int from_y = current.y - View_y, from_x = current.x - View_x;
+      for (int i = 0; i < 5 && lock.held; i++) { // Flicker for 3 cycles
+        if (to_shown) mvprintw(to_y, to_x, TELEPORTER_CHAR);
+        if (from_shown) mvprintw(from_y, from_x, TELEPORTER_CHAR);
+        wnoutrefresh(stdscr);
+        mysleep((int) (pauseTime/40));           // Short delay (50ms)
+
+        attron(A_REVERSE);
+        if (to_shown) mvprintw(to_y, to_x, TELEPORTER_CHAR);
+        if (from_shown) mvprintw(from_y, from_x, TELEPORTER_CHAR);
+        attroff(A_REVERSE);
+        wnoutrefresh(stdscr);
+        mysleep((int) (pauseTime/40));            // Another delay
+      }
+      // the next frame draws them again (and with --ansi, ncurses moved
+      // over the maze as if it were blank)
+      if (to_shown) {
+        invalidate_rows(to_y, to_y);
+      }
+      if (from_shown) {
+        invalidate_rows(from_y, from_y);
+      }
+    }
+    return;
+  }
+
+  // Check for monster
+  int monster_idx = check_monster(current.x, current.y);
+  if (monster_idx > 0) {
+    monster_idx--; // Adjust index (monster_idx was returned +1)
+    int battle_result = battle_bot_monster(monster_idx, player_id);
+
+    if (battle_result == 0) {
+      // Player lost battle, mark position as visited in player's array
+      if (!trail_at(p, current.x, current.y))
+        put_trail(p, current.x, current.y, TRAIL_ROOT);
+
+      // Also update the visualization
+      Cell visited_char = get_player_visited_char(player_id);
+      if (!is_end_cell(maze->grid[current.y][current.x]) &&
+          maze->grid[current.y][current.x] != TELEPORTER) {
+        set_cell(current.x, current.y, visited_char);
+      }
+
+      Bot_outcome[p].kind = OUTCOME_BLOCKED;
+      Bot_outcome[p].cell = current;
+      check_battles_lost(p);
+      return;
+    } else if (battle_result < 0) {
+      ; // no battle took place
+    }
+  }
+
+  // Mark as visited in player's separate visited array
+  if (!trail_at(p, current.x, current.y))
+    put_trail(p, current.x, current.y, TRAIL_ROOT);
+
+  // Also update the visualization in the shared grid
+  Cell visited_char = get_player_visited_char(player_id);
+  if (!is_end_cell(maze->grid[current.y][current.x]) &&
+      maze->grid[current.y][current.x] != TELEPORTER &&
+      maze->grid[current.y][current.x] != MONSTER &&
+      maze->grid[current.y][current.x] != DEFEATED_MONSTER) {
+    set_cell(current.x, current.y, visited_char);
+  }
+
+  // Explore onwards from here in the next propose phase
+  Bot_outcome[p].kind = OUTCOME_SETTLED;
+  Bot_outcome[p].cell = current;
+}
+
+// Resolve phase: apply the due bots' moves at once, then settle them in
+// tick order. Main thread only
+void resolve_moves() {
+  make_tick_order();
+  std::sort(Due_bots.begin(), Due_bots.end(),
+            [](int a, int b) { return Tick_rank[a] < Tick_rank[b]; });
+
+  // Bots with nothing left to explore give up
+  for (int p : Due_bots) {
+    if (Bot_move[p].x < 0) {
+      players.abandoned_race[p] = 1;
+      highlight_player_solution_path(p);
+      display_player_alert(p + 1, -1);
+    }
+  }
+
+  // Depth-first bots carry on down corridors where nobody would notice,
+  // in tick order so each leap sees the ones before
+  if (Use_corridors) {
+    for (int p : Due_bots) {
+      if (Bot_move[p].x >= 0 && players.info[p].strategy == STRAT_DFS) {
+        Bot_length[p] = corridor_leap(p, &Bot_move[p]);
+      }
+    }
+  }
+
+  // Everyone due steps at once, a corridor leap counting every cell
+  for (int p : Due_bots) {
+    if (Bot_move[p].x >= 0) {
+      move_bot(p, Bot_move[p]);
+      players.moves[p] += Bot_length[p];
+      Steps_played++;
+      if (Bot_length[p] > 1) {
+        mark_corridor(p, Bot_move[p], Bot_length[p]);
+      }
+    }
+  }
+
+  // Bots that ended up sharing a cell battle it out
+  for (int p : Due_bots) {
+    if (Bot_move[p].x >= 0) {
+      resolve_collisions(p);
+    }
+  }
+
+  // Goals, teleporters, monsters and trails for the bots still standing
+  for (int p : Due_bots) {
+    if (Bot_move[p].x >= 0) {
+      settle_bot(p);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////
+// Rewind log. Each tick's board changes (set_cell) and changed bots are
+// appended to the last segment; once they outweigh its checkpoint a new
+// checkpoint starts the next segment, so any recorded tick is rebuilt from
+// one copy of the board plus less than a board's worth of changes
+
+void bot_view(int p, BotView *v) {
+  v->x = players.current[p].x;
+  v->y = players.current[p].y;
+  v->strength = players.strength[p];
+  v->battles_won = players.battles_won[p];
+  v->battles_lost = players.battles_lost[p];
+  v->moves = players.moves[p];
+  v->reached_goal = players.reached_goal[p];
+  v->finished_rank = players.finished_rank[p];
+  v->abandoned_race = players.abandoned_race[p];
+}
+
+static size_t checkpoint_bytes() {
+  return (size_t) maze->rows * (size_t) maze->cols * sizeof(Cell) +
+         (size_t) Num_players * sizeof(BotView) + sizeof(RewindSegment);
+}
+
+static size_t change_bytes(const RewindSegment &seg) {
+  return seg.cells.size() * sizeof(CellChange) +
+         seg.bot_changes.size() * sizeof(BotChange) +
+         seg.ticks.size() * sizeof(TickMark);
+}
+
+// Memory held by a segment, spare vector capacity included
+static size_t segment_bytes(const RewindSegment &seg) {
+  return sizeof(RewindSegment) + seg.grid.capacity() * sizeof(Cell) +
+         seg.bots.capacity() * sizeof(BotView) +
+         seg.cells.capacity() * sizeof(CellChange) +
+         seg.bot_changes.capacity() * sizeof(BotChange) +
+         seg.ticks.capacity() * sizeof(TickMark);
+}
+
+// Memory held by the whole log
+size_t rewind_bytes() {
+  return Rewind.empty() ? 0 : Rewind_sealed + segment_bytes(Rewind.back());
+}
+
+// Start a segment with a copy of the board and bots as they are now
+static void rewind_checkpoint() {
+  Rewind.emplace_back();
+  RewindSegment &seg = Rewind.back();
+  seg.first_step = Rewind_steps;
+  seg.start = TickMark{Game_moves, Liv_monsters, 0, 0};
+  seg.grid.resize((size_t) maze->rows * (size_t) maze->cols);
+  for (int y = 0; y < maze->rows; y++) {
+    memcpy(&seg.grid[(size_t) y * (size_t) maze->cols], maze->grid[y],
+           (size_t) maze->cols * sizeof(Cell));
+  }
+  seg.bots = Rewind_last;
+}
+
+void rewind_clear() {
+  Rewind.clear();
+  Rewind_on = 0;
+  Rewind_sealed = 0;
+  Rewind_steps = 0;
+  Rewind_at = -1;
+}
+
+// Begin recording the round, if the budget holds a few checkpoints
+void rewind_start() {
+  rewind_clear();
+  if (Rewind_mb <= 0) {
+    return;
+  }
+  if ((size_t) Rewind_mb << 20 < 4 * checkpoint_bytes()) {
+    logMessage("Rewind budget %d MB too small for a %dx%d maze", Rewind_mb,
+               maze->rows, maze->cols);
+    return;
+  }
+  Rewind_last.resize((size_t) Num_players);
+  for (int p = 0; p < Num_players; p++) {
+    bot_view(p, &Rewind_last[(size_t) p]);
+  }
+  rewind_checkpoint();
+  Rewind_on = 1;
+}
+
+// Close the tick just played: note the bots that changed, then start a
+// new segment or drop old ones as needed
+void record_tick() {
+  if (!Rewind_on) {
+    return;
+  }
+  RewindSegment *seg = &Rewind.back();
+  for (int p = 0; p < Num_players; p++) {
+    BotView v;
+    bot_view(p, &v);
+    if (memcmp(&v, &Rewind_last[(size_t) p], sizeof(v)) != 0) {
+      seg->bot_changes.push_back(BotChange{p, v});
+      Rewind_last[(size_t) p] = v;
+    }
+  }
+  seg->ticks.push_back(TickMark{Game_moves, Liv_monsters,
+                                (uint32_t) seg->cells.size(),
+                                (uint32_t) seg->bot_changes.size()});
+  Rewind_steps++;
+
+  if (change_bytes(*seg) >= checkpoint_bytes()) {
+    seg->cells.shrink_to_fit();
+    seg->bot_changes.shrink_to_fit();
+    seg->ticks.shrink_to_fit();
+    Rewind_sealed += segment_bytes(*seg);
+    rewind_checkpoint();
+    seg = &Rewind.back();
+  }
+  size_t budget = (size_t) Rewind_mb << 20;
+  while (Rewind.size() > 1 && Rewind_sealed + segment_bytes(*seg) > budget) {
+    Rewind_sealed -= segment_bytes(Rewind.front());
+    Rewind.pop_front();
+  }
+}
+
+// Rebuild the board and bots after recorded step `step' into Rewind_grid
+// and Rewind_bots
+static void rewind_rebuild(int step) {
+  size_t s = Rewind.size() - 1;
+  while (s > 0 && Rewind[s].first_step > step) {
+    s--;
+  }
+  const RewindSegment &seg = Rewind[s];
+  const TickMark *mark = &seg.start;
+  if (step > seg.first_step) {
+    mark = &seg.ticks[(size_t) (step - seg.first_step - 1)];
+  }
+  Rewind_grid = seg.grid;
+  Rewind_bots = seg.bots;
+  for (uint32_t i = 0; i < mark->cells; i++) {
+    Rewind_grid[seg.cells[i].index] = seg.cells[i].value;
+  }
+  for (uint32_t i = 0; i < mark->bots; i++) {
+    Rewind_bots[(size_t) seg.bot_changes[i].p] = seg.bot_changes[i].view;
+  }
+  Rewind_tick = mark->tick;
+  Rewind_liv = mark->liv_monsters;
+  // bots on top, the lowest id where several share a cell
+  for (int p = Num_players - 1; p >= 0; p--) {
+    const BotView *v = &Rewind_bots[(size_t) p];
+    Rewind_grid[(size_t) v->y * (size_t) maze->cols + (size_t) v->x] =
+        get_player_current_char(p + 1);
+  }
+}
+
+// Paused: move the board `delta' recorded ticks back (or forward), the
+// step after the last recorded one being the live board
+void rewind_step(int delta) {
+  if (!Rewind_on) {
+    update_status_line("Nothing recorded to rewind");
+    return;
+  }
+  int oldest = Rewind.front().first_step;
+  int at = (Rewind_at < 0 ? Rewind_steps : Rewind_at) + delta;
+  at = at < oldest ? oldest : at;
+  if (at >= Rewind_steps) {
+    Rewind_at = -1;
+    print_maze();
+    display_player_stats();
+    update_status_line("Live at tick %d", Game_moves);
+    return;
+  }
+  long long start_ns = monotonic_ns();
+  rewind_rebuild(at);
+  long long rebuild_ns = monotonic_ns() - start_ns;
+  Rewind_at = at;
+  print_maze();
+  display_player_stats();
+  update_status_line("Rewound to tick %d of %d (%.1f ms)", Rewind_tick,
+                     Game_moves, (double) rebuild_ns / 1e6);
+}
+
+//////////////////////////////////////////////////////
+// State hash (--hash-trace). Zobrist style: the state's hash is the XOR of
+// a key for each cell's code, each bot and each monster, so a change costs
+// two XORs. The keys are mixed from the slot and the value on the fly, as
+// tables would need one per cell code. Bots and monsters are rehashed at
+// the end of a tick when they acted or battled; a bot's trail is folded
+// into its key. Two builds that play the same game write the same trace
+
+// Key of value v in slot h
+__attribute__((no_instrument_function)) static inline
+uint64_t hash_mix(uint64_t h, uint64_t v) {
+  uint64_t z = h * 0x9E3779B97F4A7C15ull ^ v;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static uint64_t bot_key(int p) {
+  const int fields[] = {
+      players.current[p].x,       players.current[p].y,
+      players.strength[p],        players.battles_won[p],
+      players.battles_lost[p],    players.moves[p],
+      players.reached_goal[p],    players.finished_rank[p],
+      players.abandoned_race[p],  players.recovery_until[p],
+      players.teleport_until[p]};
+  uint64_t h = hash_mix(1ull << 62, (uint64_t) p) ^ Trail_hash[p];
+  for (int f : fields) {
+    h = hash_mix(h, (uint64_t) (uint32_t) f);
+  }
+  return h;
+}
+
+static uint64_t monster_key(int m) {
+  const int fields[] = {
+      monsters.x[m],        monsters.y[m],        monsters.dx[m],
+      monsters.dy[m],       monsters.steps[m],    monsters.strength[m],
+      monsters.defeated[m], monsters.recovery_until[m], monsters.under[m]};
+  uint64_t h = hash_mix(2ull << 62, (uint64_t) m);
+  for (int f : fields) {
+    h = hash_mix(h, (uint64_t) (uint32_t) f);
+  }
+  return h;
+}
+
+static void rehash_bot(int p) {
+  State_hash ^= Bot_hash[p];
+  Bot_hash[p] = bot_key(p);
+  State_hash ^= Bot_hash[p];
+}
+
+static void rehash_monster(int m) {
+  State_hash ^= Monster_hash[m];
+  Monster_hash[m] = monster_key(m);
+  State_hash ^= Monster_hash[m];
+}
+
+// Hash the whole board, bots and monsters as the round starts
+void hash_start() {
+  if (!Hash_file) {
+    return;
+  }
+  State_hash = 0;
+  for (int y = 0; y < maze->rows; y++) {
+    for (int x = 0; x < maze->cols; x++) {
+      State_hash ^= hash_mix((uint64_t) y * (uint64_t) maze->cols + (uint64_t) x,
+                             maze->grid[y][x]);
+    }
+  }
+  Bot_hash.assign(Num_players, 0);
+  for (int p = 0; p < Num_players; p++) {
+    rehash_bot(p);
+  }
+  Monster_hash.assign(Num_monsters, 0);
+  for (int m = 0; m < Num_monsters; m++) {
+    rehash_monster(m);
+  }
+  Hash_touched.clear();
+}
+
+// Close the tick just played: rehash whoever acted or battled, then write
+// the round, tick, game time and hash
+void hash_tick() {
+  if (!Hash_file) {
+    return;
+  }
+  for (int p : Due_bots) {
+    rehash_bot(p);
+  }
+  for (int m : Due_monsters) {
+    rehash_monster(m);
+  }
+  for (int who : Hash_touched) {
+    if (who >= 0) {
+      rehash_bot(who);
+    } else {
+      rehash_monster(-1 - who);
+    }
+  }
+  Hash_touched.clear();
+  fprintf(Hash_file, "%d %d %d %016" PRIx64 "\n", Rounds_started, Game_moves,
+          Game_time, State_hash);
+}
+
+//////////////////////////////////////////////////////
+// Recordings. A recording is the game's seed and options followed by each
+// round's terminal size and its events, all as LEB128 varints. The game
+// is deterministic given those, so a replay plays the game again and
+// checks every event it produces against the recording, stopping at the
+// first that differs. record_event() and record_field() serve both ways
+
+// Reached the end of the recording's events before the game's end: where
+// it was quit if the game wrote its trailer, otherwise the file was cut off
+static void replay_ended() {
+  if (!Replay_complete) {
+    Exit_status = 2;
+    exit_game("%s is cut off at round %d, tick %d\n", Replay_path,
+              Rounds_started, Game_moves);
+  }
+  exit_game("%s was quit at round %d, tick %d\n", Replay_path,
+            Rounds_started, Game_moves);
+}
+
+static int replay_byte() {
+  if (Replay_pos >= Replay_end) {
+    replay_ended();
+  }
+  return Replay_data[Replay_pos++];
+}
+
+// Write an event, or check it against the recording when replaying
+__attribute__((no_instrument_function))
+void record_event(uint64_t v) {
+  if (!Record_file && !Replay_path) {
+    return;
+  }
+  do {
+    int byte = (int) (v & 0x7F) | (v >= 0x80 ? 0x80 : 0);
+    v >>= 7;
+    if (Record_file) {
+      putc(byte, Record_file);
+    } else if (replay_byte() != byte) {
+      Exit_status = 2;
+      exit_game("Replay diverged from %s at round %d, tick %d\n",
+                Replay_path, Rounds_started, Game_moves);
+    }
+  } while (v);
+}
+
+// A header field: written when recording, read back when replaying
+uint64_t record_field(uint64_t v) {
+  if (Record_file) {
+    record_event(v);
+    return v;
+  }
+  if (!Replay_path) {
+    return v;
+  }
+  v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = replay_byte();
+    v |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+  return v;
+}
+
+// Signed fields, zigzag encoded so -1 stays one byte
+static int record_int(int v) {
+  uint64_t z = ((uint64_t) (uint32_t) v << 1) ^ (uint64_t) (v < 0 ? -1 : 0);
+  z = record_field(z & 0xFFFFFFFFull);
+  return (int) ((uint32_t) (z >> 1) ^ (uint32_t) -(int64_t) (z & 1));
+}
+
+// The seed and the options that shape the game
+void record_header() {
+  Seed = (unsigned int) record_field(Seed);
+  Num_players = record_int(Num_players);
+  Num_teleporters = record_int(Num_teleporters);
+  Num_monsters = record_int(Num_monsters);
+  Max_monster_strength = record_int(Max_monster_strength);
+  Speed_spread = record_int(Speed_spread);
+  Use_corridors = record_int(Use_corridors);
+  Monster_pursuit = record_int(Monster_pursuit);
+  Game_rounds = record_int(Game_rounds);
+  int num_strategies = record_int((int) Strategies.size());
+  Strategies.resize((size_t) (num_strategies < 0 ? 0 : num_strategies));
+  for (int &s : Strategies) {
+    s = record_int(s);
+    if (s < 0 || s >= NUM_STRATEGIES) {
+      s = STRAT_DFS;
+    }
+  }
+}
+
+// Write the trailer that says the recording is whole, as the game ends
+void record_end() {
+  long length = ftell(Record_file);
+  for (int i = 0; i < 8; i++) {
+    putc((int) ((uint64_t) length >> (8 * i) & 0xFF), Record_file);
+  }
+  fputs(RECORD_END, Record_file);
+}
+
+// Read a whole recording and check its magic and version. One without its
+// trailer still loads, to be played up to where it was cut off
+int load_replay(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return 0;
+  }
+  uint8_t buffer[1 << 16];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    Replay_data.insert(Replay_data.end(), buffer, buffer + n);
+  }
+  fclose(fp);
+  size_t magic = strlen(RECORD_MAGIC);
+  if (Replay_data.size() <= magic ||
+      memcmp(Replay_data.data(), RECORD_MAGIC, magic) != 0 ||
+      Replay_data[magic] != RECORD_VERSION) {
+    return 0;
+  }
+  Replay_pos = magic + 1;
+  Replay_end = Replay_data.size();
+  size_t end = strlen(RECORD_END);
+  if (Replay_end >= Replay_pos + 8 + end &&
+      memcmp(Replay_data.data() + Replay_end - end, RECORD_END, end) == 0) {
+    uint64_t length = 0;
+    for (int i = 0; i < 8; i++) {
+      length |= (uint64_t) Replay_data[Replay_end - end - 8 + (size_t) i]
+                << (8 * i);
+    }
+    if (length == Replay_end - end - 8) {
+      Replay_end = (size_t) length;
+      Replay_complete = 1;
+    }
+  }
+  return 1;
+}
+
+// Replaying: whether the recorded round was cut short (by the terminal
+// shrinking) after the tick just played
+int replay_cut_short() {
+  return Replay_path && Replay_pos < Replay_end &&
+         Replay_data[Replay_pos] == (1 << 3 | EV_CONTROL);
+}
+
+//////////////////////////////////////////////////////
+// Snapshots. Bot controllers are coroutines whose frames can't be saved,
+// so a snapshot keeps what the round was made from (Round_start) and
+// --resume plays that round again silently up to the saved tick, then
+// checks the board, bots and monsters against the image before carrying on
+
+static inline const SnapshotHeader *resume_header() {
+  return (const SnapshotHeader *) Resume_map;
+}
+
+// The snapshot being resumed, if this is its round and it hasn't caught up
+const SnapshotHeader *resume_round() {
+  const SnapshotHeader *h = resume_header();
+  return h && h->round == Rounds_started ? h : NULL;
+}
+
+size_t snapshot_bytes(int rows, int cols, int bots, int mons, int strategies) {
+  return sizeof(SnapshotHeader) + (size_t) rows * (size_t) cols * sizeof(Cell) +
+         (size_t) bots * sizeof(BotView) +
+         (size_t) mons * sizeof(SnapshotMonster) + sizeof(teleporters) +
+         sizeof(status_lines) + (size_t) strategies * sizeof(int);
+}
+
+// Save the game as it stands after this tick to Snapshot_path. The image is
+// filled in through a mapping of a temporary file that then replaces the
+// last snapshot, so a crash mid-save leaves the old one. Returns 0 if it
+// couldn't be written
+int save_snapshot() {
+  SnapshotHeader h;
+  char tmp_path[1024];
+  int strategies = (int) Strategies.size();
+  size_t bytes = snapshot_bytes(maze->rows, maze->cols, Num_players,
+                                Num_monsters, strategies);
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", Snapshot_path);
+  int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return 0;
+  }
+  if (ftruncate(fd, (off_t) bytes) != 0) {
+    close(fd);
+    unlink(tmp_path);
+    return 0;
+  }
+  uint8_t *image = (uint8_t *) mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    unlink(tmp_path);
+    return 0;
+  }
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+  h.version = SNAPSHOT_VERSION;
+  h.bytes = bytes;
+  h.seed = Seed;
+  h.num_players = Num_players;
+  h.speed_spread = Speed_spread;
+  h.use_corridors = Use_corridors;
+  h.pursuit = Monster_pursuit;
+  h.num_strategies = strategies;
+  h.maze_rows = Maze_rows;
+  h.maze_cols = Maze_cols;
+  h.rounds_left = Game_rounds;
+  h.rounds_total = Game_roundsB;
+  h.round = Rounds_started;
+  h.start = Round_start;
+  h.game_time = Game_time;
+  h.liv_monsters = Liv_monsters;
+  h.players_finished = Players_finished;
+  h.rows = maze->rows;
+  h.cols = maze->cols;
+  h.num_monsters = Num_monsters;
+  h.num_teleporters = Num_teleporters;
+
+  // Sections are packed, so everything goes through memcpy
+  uint8_t *at = image;
+  memcpy(at, &h, sizeof(h));
+  at += sizeof(h);
+  for (int y = 0; y < maze->rows; y++) {
+    memcpy(at, maze->grid[y], (size_t) maze->cols * sizeof(Cell));
+    at += (size_t) maze->cols * sizeof(Cell);
+  }
+  for (int p = 0; p < Num_players; p++) {
+    BotView v;
+    bot_view(p, &v);
+    memcpy(at, &v, sizeof(v));
+    at += sizeof(v);
+  }
+  for (int m = 0; m < Num_monsters; m++) {
+    SnapshotMonster sm = {monsters.x[m], monsters.y[m], monsters.strength[m],
+                          monsters.defeated[m]};
+    memcpy(at, &sm, sizeof(sm));
+    at += sizeof(sm);
+  }
+  memcpy(at, teleporters, sizeof(teleporters));
+  at += sizeof(teleporters);
+  memcpy(at, status_lines, sizeof(status_lines));
+  at += sizeof(status_lines);
+  if (strategies > 0) {
+    memcpy(at, Strategies.data(), (size_t) strategies * sizeof(int));
+  }
+  munmap(image, bytes);
+  return rename(tmp_path, Snapshot_path) == 0;
+}
+
+// Save a snapshot for the s key or a signal, and quit if that was asked for
+void snapshot_now() {
+  Snapshot_wanted = 0;
+  int saved = save_snapshot();
+  if (Snapshot_quit) {
+    Exit_status = saved ? 0 : 1;
+    exit_game(saved ? "Saved round %d, tick %d to %s\n"
+                    : "Round %d, tick %d: can't save a snapshot to %s\n",
+              Rounds_started, Game_moves, Snapshot_path);
+  }
+  if (Headless) {
+    fprintf(stderr, saved ? "Saved round %d, tick %d to %s\n"
+                          : "Round %d, tick %d: can't save a snapshot to %s\n",
+            Rounds_started, Game_moves, Snapshot_path);
+  } else {
+    update_status_line(saved ? "Snapshot saved to %s" : "Can't save to %s",
+                       Snapshot_path);
+  }
+}
+
+// Map a snapshot for --resume and take the game's options from it. Returns
+// 0 if it isn't a snapshot of this version or holds settings it can't have
+int load_snapshot(const char *path) {
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(SnapshotHeader)) {
+    close(fd);
+    return 0;
+  }
+  void *image = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    return 0;
+  }
+  const SnapshotHeader *h = (const SnapshotHeader *) image;
+  if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 ||
+      h->version != SNAPSHOT_VERSION || h->bytes != (uint64_t) st.st_size ||
+      h->rows < 1 || h->rows > MAX_ROWS || h->cols < 1 || h->cols > MAX_COLS ||
+      h->num_players < 1 || h->num_players > MAX_PLAYERS ||
+      h->num_monsters < 0 || h->num_monsters > MAX_MONSTERS ||
+      h->num_strategies < 0 || h->round < 1 || h->rounds_left < 1 ||
+      h->bytes != snapshot_bytes(h->rows, h->cols, h->num_players,
+                                 h->num_monsters, h->num_strategies) ||
+      h->start.term_rows < MIN_ROWS || h->start.term_rows > MAX_ROWS + 6 ||
+      h->start.term_cols < MIN_COLS || h->start.term_cols > MAX_COLS + 2) {
+    munmap(image, (size_t) st.st_size);
+    return 0;
+  }
+  // the strategies index STRATEGY_NAMES, so one the game doesn't know
+  // means the file isn't one of its snapshots
+  std::vector<int> strategies((size_t) h->num_strategies);
+  if (h->num_strategies > 0) {
+    memcpy(strategies.data(), (const uint8_t *) image + st.st_size -
+                                  (size_t) h->num_strategies * sizeof(int),
+           (size_t) h->num_strategies * sizeof(int));
+  }
+  for (int s : strategies) {
+    if (s < 0 || s >= NUM_STRATEGIES) {
+      munmap(image, (size_t) st.st_size);
+      return 0;
+    }
+  }
+  Resume_map = (const uint8_t *) image;
+  Resume_size = (size_t) st.st_size;
+
+  Seed = h->seed;
+  Num_players = h->num_players;
+  Speed_spread = h->speed_spread;
+  Use_corridors = h->use_corridors;
+  Monster_pursuit = h->pursuit;
+  Maze_rows = h->maze_rows;
+  Maze_cols = h->maze_cols;
+  Strategies = strategies;
+  Game_rounds = h->rounds_left;
+  Rounds_started = h->round - 1;
+  return 1;
+}
+
+// Caught up with the snapshot being resumed: check the round came out as it
+// was saved, take its status history and show the board from here on
+void resume_check() {
+  const SnapshotHeader *h = resume_header();
+  const uint8_t *at = Resume_map + sizeof(SnapshotHeader);
+  int same = h->rows == maze->rows && h->cols == maze->cols &&
+             h->num_monsters == Num_monsters &&
+             h->num_teleporters == Num_teleporters &&
+             h->liv_monsters == Liv_monsters &&
+             h->players_finished == Players_finished;
+
+  for (int y = 0; same && y < maze->rows; y++) {
+    same = memcmp(at, maze->grid[y], (size_t) maze->cols * sizeof(Cell)) == 0;
+    at += (size_t) maze->cols * sizeof(Cell);
+  }
+  for (int p = 0; same && p < Num_players; p++) {
+    BotView v;
+    bot_view(p, &v);
+    same = memcmp(at, &v, sizeof(v)) == 0;
+    at += sizeof(v);
+  }
+  for (int m = 0; same && m < Num_monsters; m++) {
+    SnapshotMonster sm = {monsters.x[m], monsters.y[m], monsters.strength[m],
+                          monsters.defeated[m]};
+    same = memcmp(at, &sm, sizeof(sm)) == 0;
+    at += sizeof(sm);
+  }
+  if (same) {
+    same = memcmp(at, teleporters, sizeof(teleporters)) == 0;
+    at += sizeof(teleporters);
+  }
+  if (!same) {
+    Exit_status = 1;
+    exit_game("%s doesn't match the game it resumes (another version?) at "
+              "round %d, tick %d\n", Resume_path, Rounds_started, Game_moves);
+  }
+  memcpy(status_lines, at, sizeof(status_lines));
+  munmap((void *) Resume_map, Resume_size);
+  Resume_map = NULL;
+
+  Fast_forward = 0;
+  if (Headless) {
+    fprintf(stderr, "Resumed round %d at tick %d\n", Rounds_started,
+            Game_moves);
+    return;
+  }
+  print_maze();
+  display_player_stats();
+  update_status_line("Resumed round %d at tick %d", Rounds_started,
+                     Game_moves);
+}
+
+void solve_maze_multi() {
+  // Each bot has its own stack, so proposals never interfere
+  Bot_stacks.assign(Num_players, NULL);
+  Bot_move.assign(Num_players, Position{-1, -1, -1, -1});
+  Bot_outcome.assign(Num_players, Outcome{OUTCOME_NONE, {-1, -1, -1, -1}});
+  Bot_length.assign(Num_players, 1);
+  Bot_leap.assign(Num_players, LeapSpan{0, 0, 0, 0, 0});
+  Frontier.clear();
+  if (Use_corridors) {
+    Block_cols = (maze->cols + LEAP_BLOCK - 1) / LEAP_BLOCK;
+    Num_blocks = Block_cols * ((maze->rows + LEAP_BLOCK - 1) / LEAP_BLOCK);
+    Frontier.assign((size_t) Num_players * (size_t) Num_blocks, 0);
+    Block_teleporters.assign((size_t) Num_blocks, 0);
+    for (int i = 0; i < Num_teleporters; i++) {
+      Block_teleporters[(size_t) block_of(teleporters[i].x1, teleporters[i].y1)] = 1;
+      Block_teleporters[(size_t) block_of(teleporters[i].x2, teleporters[i].y2)] = 1;
+    }
+    Min_bot_period = *std::min_element(players.period.begin(),
+                                       players.period.end());
+  }
+  Trail_hash.assign(Num_players, 0);
+  Steps_played = 0;
+
+  // Push each player's starting position onto their stack
+  for (int p = 0; p < Num_players; p++) {
+    push_stack(&Bot_stacks[p], players.info[p].start);
+    // Mark start position as visited
+    put_trail(p, players.info[p].start.x, players.info[p].start.y, TRAIL_ROOT);
+  }
+  rewind_start();
+  hash_start();
+
+  // Start each bot's controller (suspended until its first turn)
+  Bot_tasks.clear();
+  if (Use_coroutines) {
+    for (int p = 0; p < Num_players; p++) {
+      Bot_tasks.push_back(start_controller(p));
+    }
+  }
+
+  // Everyone acts at time 0, then at their own period. Defeated monsters
+  // and bots that are out of the race are not rescheduled, so they cost
+  // nothing, and spans where nobody acts are skipped
+  std::priority_queue<Event, std::vector<Event>, EventLater> events;
+  int queued_bots = 0;
+  int last_time = 0;
+  for (int p = 0; p < Num_players; p++) {
+    events.push(Event{0, p});
+    queued_bots++;
+  }
+  for (int m = 0; m < Num_monsters; m++) {
+    events.push(Event{0, -1 - m});
+  }
+  Bot_due.assign(Num_players, 0);
+  Monster_due.assign(Num_monsters, 0);
+  Tick_due_ns = monotonic_ns();
+  Frame_due_ns = 0;
+
+  //////////////////////////////////////////////////
+  // Start Main solve loop - continue until all players finish or leave
+  while (queued_bots > 0 && Players_finished < Num_players) {
+    // Take every event due at the earliest time
+    Game_time = events.top().time;
+    Game_moves = Game_time / TICK_TIME;
+    record_event((uint64_t) (Game_time - last_time + 2) << 3 | EV_CONTROL);
+    last_time = Game_time;
+    Record_monster = -1;
+    // Replaying with --jump: played silently up to here, show it from now
+    if (Jump_round > 0 && Rounds_started == Jump_round &&
+        Game_moves >= Jump_tick) {
+      Jump_round = 0;
+      Fast_forward = 0;
+      invalidate_shadow(); // all of it with the tick's frame
+      update_status_line("Jumped to round %d, tick %d", Rounds_started,
+                         Game_moves);
+    }
+    Due_bots.clear();
+    Due_monsters.clear();
+    while (!events.empty() && events.top().time == Game_time) {
+      int who = events.top().who;
+      events.pop();
+      if (who >= 0) {
+        queued_bots--;
+        if (!players.reached_goal[who] && !players.abandoned_race[who]) {
+          Due_bots.push_back(who);
+          Bot_due[who] = 1;
+        }
+      } else if (!monsters.defeated[-1 - who]) {
+        Due_monsters.push_back(-1 - who);
+        Monster_due[-1 - who] = 1;
+      }
+    }
+    std::sort(Due_monsters.begin(), Due_monsters.end());
+
+    // Propose: every due bot picks its next cell
+    parallel_for((int) Due_bots.size(), propose_due);
+
+    // Resolve: apply the moves and everything they trigger
+    resolve_moves();
+
+    // Then the due monsters move
+    update_monsters();
+
+    // Schedule the next turns, a corridor leap takes as long as its cells
+    for (int p : Due_bots) {
+      Bot_due[p] = 0;
+      if (!players.reached_goal[p] && !players.abandoned_race[p]) {
+        events.push(Event{Game_time + players.period[p] * Bot_length[p], p});
+        queued_bots++;
+      }
+    }
+    for (int m : Due_monsters) {
+      Monster_due[m] = 0;
+      if (!monsters.defeated[m]) {
+        events.push(Event{Game_time + monsters.period[m], -1 - m});
+      }
+    }
+    record_tick();
+    hash_tick();
+    // Resuming: played silently up to the snapshot, carry on from here
+    if (resume_round() && Game_time == resume_header()->game_time) {
+      resume_check();
+    }
+    // s key or a signal: save the game as it stands after this tick
+    if (Snapshot_wanted) {
+      snapshot_now();
+    }
+    // Replaying a round the terminal cut short: stop where it stopped
+    if (replay_cut_short()) {
+      Screen_reduced = 1;
+      break;
+    }
+    if (Headless || Fast_forward)
+      continue;
+
+    // Visualize exploration (with --fps, only when a frame is due), then
+    // wait for the game time to the next event
+    int next_time = events.empty() ? Game_time + TICK_TIME : events.top().time;
+    long long now_ns = monotonic_ns();
+    int frame_rate = Frame_rate;
+    int cap = Frame_cap.load(std::memory_order_relaxed);
+    if (cap && (!frame_rate || cap < frame_rate)) {
+      frame_rate = cap; // the terminal can't take more
+    }
+    if (!frame_rate || now_ns >= Frame_due_ns) {
+      publish_frame();
+      Frame_due_ns += 1000000000LL / MAX(frame_rate, 1);
+      if (Frame_due_ns < now_ns) {
+        Frame_due_ns = now_ns + 1000000000LL / MAX(frame_rate, 1);
+      }
+    }
+    if (cap != Adapt_shown) {
+      Adapt_shown = cap;
+      if (cap) {
+        update_status_line("Slow terminal: %d fps, %d cells a frame, no effects",
+                           cap, Frame_cells.load(std::memory_order_relaxed));
+      } else {
+        update_status_line("Terminal caught up: every frame drawn");
+      }
+    }
+    read_keyboard();
+    if (LastSLupdate && LastSLupdate+25 < Game_moves) {
+      // not worth waiting for the render thread over
+      std::unique_lock<std::recursive_timed_mutex> lock(Curses_lock, std::try_to_lock);
+      if (lock.owns_lock()) {
+        move(View_rows + 5, 0);
+        wclrtoeol(stdscr);
+      }
+    }
+    pace_ticks(next_time - Game_time);
+
+    // Check for window resize (a replay keeps the recorded size)
+    if (!Replay_path) {
+      struct winsize size;
+
+      ioctl(STDOUT_FILENO, TIOCGWINSZ, &size); // Get new size
       if (old_rows != size.ws_row || old_cols != size.ws_col) {
+        old_rows = size.ws_row ; old_cols = size.ws_col;      
+        {
+          // the round plays on, in a view sized to the new screen
+          CursesLock lock;
+          resizeterm(size.ws_row, size.ws_col);
+          getmaxyx(stdscr, Term_rows, Term_cols);
+          clear();
+          invalidate_shadow();
+          place_view();
+        }
         update_status_line("Caught term resize to %d, %d", size.ws_row, size.ws_col);
         logMessage("Caught term resize to %d, %d", size.ws_row, size.ws_col);
-        if (old_rows > size.ws_row || old_cols > size.ws_col) {
-          // abort current solve as screen has reduced in size
-          Screen_reduced = 1;
-          old_rows = size.ws_row ; old_cols = size.ws_col; 
-          // spin wheels in lieu of debounce
-          mysleep(2000);
-          // break
-          break;
+        // the next round's layout may be for the old size, start again
+        int rows, cols;
+        round_size(&rows, &cols);
+        if (Next_layout && (Next_layout->term_rows != rows ||
+                            Next_layout->term_cols != cols)) {
+          Layout *stale = finish_layout();
+          request_layout(rows, cols, stale->seed);
+          free_layout(stale);
         }
-        old_rows = size.ws_row ; old_cols = size.ws_col;      
       }
     }
-    doupdate();
   }
   // end Main solve loop
   //////////////////////////////////////////////////
+  // Resuming, but the round ended before the snapshot's tick
+  if (resume_round()) {
+    resume_check();
+  }
+  // the last ticks may not have had a frame drawn
+  if (!Headless && !Fast_forward) {
+    CursesLock lock;
+    print_maze();
+    display_player_stats();
+    doupdate();
+  }
+  Game_moves = Game_time / TICK_TIME + 1; // ticks played
+  record_event((uint64_t) Screen_reduced << 3 | EV_CONTROL);
+  if (Record_file) {
+    fflush(Record_file);
+  }
+
+  // Free controllers and stacks
+  Bot_tasks.clear();
+  for (int p = 0; p < Num_players; p++) {
+    clear_stack(&Bot_stacks[p]);
+  }
+
+  // Show final results
+  if (Headless)
+    return;
+  if (Fast_forward && Jump_round > 0) {
+    Fast_forward = 0; // a round skipped on the way to --jump
+  } else if (Fast_forward) {
+    // caught up: the board with the solution paths of the finished bots
+    Fast_forward = 0;
+    print_maze();
+    update_status_line("Fast forwarded to tick %d", Game_moves);
+    display_player_stats();
+    pauseForUser();
+  }
+  CursesLock lock;
+  if(!Screen_reduced) display_player_stats();
+  doupdate();
+}
+// end solve_maze_multi
+//////////////////////////////////////////////////////
+
+__attribute__((no_instrument_function)) static inline 
+void print_char(int i, int j, Cell ichar) {
+  if (Use_glyph_table && ichar < CELL_CODES) {
+    mvadd_wch(i, j, &Glyphs[ichar]); // attron() still applies, as for A_REVERSE
+    return;
+  }
+  move(i, j);
+  draw_cell(ichar);
+}
 
-  // Free stacks
-  for (int p = 0; p < NUM_PLAYERS; p++) {
-    clear_stack(&stacks[p]);
+// Set one cell code's glyph, and how --ansi writes it, from its UTF-8 text
+static void set_glyph(Cell c, const char *text, attr_t attrs, short pair) {
+  wchar_t wide[4] = {0};
+  if (mbstowcs(wide, text, 1) != 1) {
+    wide[0] = L'?'; // not a character in this locale
   }
+  wide[1] = L'\0';
+  setcchar(&Glyphs[c], wide, attrs, pair, NULL);
 
-  // Show final results
-  if(!Screen_reduced) display_player_stats();
-  doupdate();
+  AnsiGlyph *g = &Ansi_glyphs[c];
+  g->len = snprintf(g->text, sizeof(g->text), "%s", text);
+  g->len = MIN(g->len, (int) sizeof(g->text) - 1);
+  g->style = ansi_pair_style(pair, attrs);
+}
+
+// Build the drawn form of every cell code, the way draw_cell() draws it,
+// for this round's bots
+void build_glyphs() {
+  CursesLock lock;
+  Glyphs.resize(CELL_CODES);
+  Ansi_glyphs.resize(CELL_CODES);
+  for (int c = 0; c < CELL_CODES; c++) {
+    set_glyph((Cell) c, "!", A_NORMAL, 8);
+  }
+  set_glyph(WALL, WALL_CHAR, A_NORMAL, 0);
+  set_glyph(PATH, PATH_CHAR, A_NORMAL, 1);
+  set_glyph(TELEPORTER, TELEPORTER_CHAR, A_BOLD, 7);
+  set_glyph(MONSTER, MONSTER_CHAR, A_BOLD, 8);
+  set_glyph(DEFEATED_MONSTER, DEFEATED_MONSTER_CHAR, A_BOLD, 9);
+  for (int p = 0; p < Num_players; p++) {
+    PlayerInfo *pl = &players.info[p];
+    short pair = (short) pl->color_pair;
+    set_glyph((Cell) (CURRENT_BASE + p), pl->current_glyph, A_BOLD, pair);
+    set_glyph((Cell) (VISITED_BASE + p), VISITED_CHAR, A_NORMAL, pair);
+    set_glyph((Cell) (SOLUTION_BASE + p), SOLUTION_CHAR, A_BOLD, pair);
+    set_glyph((Cell) (END_BASE + p), pl->end_glyph, A_BOLD, pair);
+  }
+  invalidate_shadow();
 }
-// end solve_maze_multi
-//////////////////////////////////////////////////////
 
+// Draw one cell at the cursor from its UTF-8 text
 __attribute__((no_instrument_function)) static inline 
-void print_char(int i, int j, char ichar) {
-  move(i, j);
+void draw_cell(Cell ichar) {
+  // Per-bot cells, drawn in the bot's colour
+  if (ichar >= CURRENT_BASE && ichar < CELL_CODES &&
+      CELL_PLAYER(ichar) < Num_players) {
+    PlayerInfo *pl = &players.info[CELL_PLAYER(ichar)];
+    switch (CELL_KIND(ichar)) {
+    case CURRENT_BASE:
+      attron(COLOR_PAIR(pl->color_pair) | A_BOLD);
+      addstr(pl->current_glyph);
+      attroff(COLOR_PAIR(pl->color_pair) | A_BOLD);
+      break;
+    case VISITED_BASE:
+      attron(COLOR_PAIR(pl->color_pair));
+      addstr(VISITED_CHAR);
+      attroff(COLOR_PAIR(pl->color_pair));
+      break;
+    case SOLUTION_BASE:
+      attron(COLOR_PAIR(pl->color_pair) | A_BOLD);
+      addstr(SOLUTION_CHAR);
+      attroff(COLOR_PAIR(pl->color_pair) | A_BOLD);
+      break;
+    case END_BASE:
+      attron(COLOR_PAIR(pl->color_pair) | A_BOLD);
+      addstr(pl->end_glyph);
+      attroff(COLOR_PAIR(pl->color_pair) | A_BOLD);
+      break;
+    }
+    return;
+  }
   // Otherwise, display the appropriate cell character
   switch (ichar) {  
-  // Player 1 cells
-  case CURRENT1:
-    attron(COLOR_PAIR(2) | A_BOLD);
-    addstr(CURRENT_CHAR1);
-    attroff(COLOR_PAIR(2) | A_BOLD);
-    break;
-  case VISITED1:
-    attron(COLOR_PAIR(2));
-    addstr(VISITED_CHAR1);
-    attroff(COLOR_PAIR(2));
-    break;
-  case SOLUTION1:
-    attron(COLOR_PAIR(2) | A_BOLD);
-    addstr(SOLUTION_CHAR1);
-    attroff(COLOR_PAIR(2) | A_BOLD);
-    break;
-  case END1:
-    attron(COLOR_PAIR(2) | A_BOLD);
-    addstr(END_CHAR1);
-    attroff(COLOR_PAIR(2) | A_BOLD);
-    break;
-  
-  // Player 2 cells
-  case CURRENT2:
-    attron(COLOR_PAIR(3) | A_BOLD);
-    addstr(CURRENT_CHAR2);
-    attroff(COLOR_PAIR(3) | A_BOLD);
-    break;
-  case VISITED2:
-    attron(COLOR_PAIR(3));
-    addstr(VISITED_CHAR2);
-    attroff(COLOR_PAIR(3));
-    break;
-  case SOLUTION2:
-    attron(COLOR_PAIR(3) | A_BOLD);
-    addstr(SOLUTION_CHAR2);
-    attroff(COLOR_PAIR(3) | A_BOLD);
-    break;
-  case END2:
-    attron(COLOR_PAIR(3) | A_BOLD);
-    addstr(END_CHAR2);
-    attroff(COLOR_PAIR(3) | A_BOLD);
-    break;
-  
-  // Player 3 cells
-  case CURRENT3:
-    attron(COLOR_PAIR(4) | A_BOLD);
-    addstr(CURRENT_CHAR3);
-    attroff(COLOR_PAIR(4) | A_BOLD);
-    break;
-  case VISITED3:
-    attron(COLOR_PAIR(4));
-    addstr(VISITED_CHAR3);
-    attroff(COLOR_PAIR(4));
-    break;
-  case SOLUTION3:
-    attron(COLOR_PAIR(4) | A_BOLD);
-    addstr(SOLUTION_CHAR3);
-    attroff(COLOR_PAIR(4) | A_BOLD);
-    break;
-  case END3:
-    attron(COLOR_PAIR(4) | A_BOLD);
-    addstr(END_CHAR3);
-    attroff(COLOR_PAIR(4) | A_BOLD);
-    break;
-  
-  // Player 4 cells
-  case CURRENT4:
-    attron(COLOR_PAIR(5) | A_BOLD);
-    addstr(CURRENT_CHAR4);
-    attroff(COLOR_PAIR(5) | A_BOLD);
-    break;
-  case VISITED4:
-    attron(COLOR_PAIR(5));
-    addstr(VISITED_CHAR4);
-    attroff(COLOR_PAIR(5));
-    break;
-  case SOLUTION4:
-    attron(COLOR_PAIR(5) | A_BOLD);
-    addstr(SOLUTION_CHAR4);
-    attroff(COLOR_PAIR(5) | A_BOLD);
-    break;
-  case END4:
-    attron(COLOR_PAIR(5) | A_BOLD);
-    addstr(END_CHAR4);
-    attroff(COLOR_PAIR(5) | A_BOLD);
-    break;
-  
   // Special cells
   case WALL:
     addstr(WALL_CHAR);
@@ -2245,40 +6241,630 @@ void print_char(int i, int j, char ichar) {
   }
 }
 
-// print_maze to display all players, teleporters, and monsters
-void print_maze() {
-  // Get current terminal dimensions
-  int term_rows, term_cols;
-  getmaxyx(stdscr, term_rows, term_cols);
+// First cell in [from, n) where rows a and b differ, or n. Compares a
+// vector of cells at a time; the maze mostly doesn't change between frames
+__attribute__((no_instrument_function)) static inline 
+int find_change(const Cell *a, const Cell *b, int from, int n) {
+  typedef Cell CellVec __attribute__((vector_size(16)));
+  typedef long long MaskVec __attribute__((vector_size(16)));
+  const int lanes = (int) (sizeof(CellVec) / sizeof(Cell));
+  int j = from;
+  for (; j + lanes <= n; j += lanes) {
+    CellVec va, vb;
+    memcpy(&va, a + j, sizeof(va));
+    memcpy(&vb, b + j, sizeof(vb));
+    MaskVec ne = (MaskVec) (va != vb);
+    if (ne[0] | ne[1]) {
+      break;
+    }
+  }
+  while (j < n && a[j] == b[j]) {
+    j++;
+  }
+  return j;
+}
+
+// The next frame will redraw the whole maze
+void invalidate_shadow() {
+  invalidate_rows(0, INT_MAX);
+}
+
+// The next frame will redraw rows from..to of the screen, which an effect
+// drew over. Only notes them, whichever thread draws next takes them
+void invalidate_rows(int from, int to) {
+  std::lock_guard<std::mutex> lock(Frame_lock);
+  Stale_from = MIN(Stale_from, from);
+  Stale_to = MAX(Stale_to, to);
+}
+
+// Forget what was drawn on the rows invalidated since the last frame, so
+// this one draws them again. Holds Curses_lock
+void take_stale_rows() {
+  int from, to;
+  {
+    std::lock_guard<std::mutex> lock(Frame_lock);
+    from = Stale_from;
+    to = Stale_to;
+    Stale_from = INT_MAX;
+    Stale_to = -1;
+  }
+  if (from > to) {
+    return;
+  }
+  from = MAX(from, 0);
+  if (to >= Shadow_rows) {
+    Ansi_stats_row = -1; // the stats panel too
+  }
+  to = MIN(to, Shadow_rows - 1);
+  if (from <= to) {
+    std::fill(Shadow.begin() + (long) from * Shadow_cols,
+              Shadow.begin() + (long) (to + 1) * Shadow_cols,
+              (Cell) CELL_STALE);
+  }
+  if (from == 0) {
+    Ansi_info[0] = '\0';
+  }
+}
+
+// The bot the view follows unless one is picked: the racing bot with the
+// fewest moves left, or the winner once none are racing
+int leading_bot() {
+  int lead = 0, best = INT_MAX;
+  for (int p = 0; p < Num_players; p++) {
+    int left = goal_moves(p, players.current[p].x, players.current[p].y);
+    if (!players.reached_goal[p] && !players.abandoned_race[p] && left >= 0 &&
+        left < best) {
+      lead = p;
+      best = left;
+    } else if (best == INT_MAX && players.reached_goal[p] &&
+               players.finished_rank[p] == 1) {
+      lead = p;
+    }
+  }
+  return lead;
+}
+
+// Size the view to the terminal (the maze, then the stats panel and status
+// line below it) and keep the bot it follows in its middle half: once the
+// bot leaves that, the view is centred on it again, so it scrolls by half a
+// screen now and then rather than with every move
+void place_view() {
+  View_rows = MAX(MIN(maze->rows, Term_rows - 6), 0);
+  View_cols = MAX(MIN(maze->cols, Term_cols - 1), 0);
+
+  if (!View_panned && Num_players > 0) {
+    int p = View_follow >= 0 && View_follow < Num_players ? View_follow
+                                                          : leading_bot();
+    int y = players.current[p].y, x = players.current[p].x;
+    if (Rewind_at >= 0) {
+      y = Rewind_bots[(size_t) p].y; // where it was at the tick shown
+      x = Rewind_bots[(size_t) p].x;
+    }
+    if (y < View_y + View_rows / 4 || y >= View_y + View_rows - View_rows / 4) {
+      View_y = y - View_rows / 2;
+    }
+    if (x < View_x + View_cols / 4 || x >= View_x + View_cols - View_cols / 4) {
+      View_x = x - View_cols / 2;
+    }
+  }
+  View_y = MAX(MIN(View_y, maze->rows - View_rows), 0);
+  View_x = MAX(MIN(View_x, maze->cols - View_cols), 0);
+}
+
+// Whether maze cell y, x is on screen, at y - View_y, x - View_x
+static inline int in_view(int y, int x) {
+  return y >= View_y && y < View_y + View_rows && x >= View_x &&
+         x < View_x + View_cols;
+}
+
+// Move the view a quarter screen per step with the pan keys, drawn at once
+// (paused, no frames are drawn); it stays there until the bot it follows
+// is picked again
+void pan_view(int dy, int dx) {
+  View_panned = 1;
+  View_y += dy * MAX(View_rows / 4, 1);
+  View_x += dx * MAX(View_cols / 4, 1);
+  print_maze();
+}
 
-  // Ensure we don't write outside the terminal
-  int visible_rows = (maze->rows < term_rows - 6) ? maze->rows : term_rows - 6;
-  int visible_cols = (maze->cols < term_cols) ? maze->cols : term_cols - 1;
+// Have the view follow bot p, or whichever leads for -1, from wherever the
+// pan keys left it
+void follow_bot(int p) {
+  View_follow = p;
+  View_panned = 0;
+  if (p < 0) {
+    update_status_line("View follows the leading bot");
+  } else {
+    update_status_line("View follows %s", bot_name(p));
+  }
+  print_maze();
+}
 
-  Position current_positions[NUM_PLAYERS];
-  for (int i = 0; i < NUM_PLAYERS; i++) {
-    current_positions[i] = players[i].current;
+// Compose the maze part of a frame: the cells in view (the live board with
+// its bots, or the tick being rewound to) and the game info
+void compose_maze(BoardFrame *f) {
+  place_view();
+  f->rows = View_rows;
+  f->cols = View_cols;
+  f->cells.resize((size_t) f->rows * (size_t) f->cols);
+
+  for (int i = 0; i < f->rows; i++) {
+    Cell *row = &f->cells[(size_t) i * (size_t) f->cols];
+    int y = View_y + i;
+    if (Rewind_at >= 0) {
+      memcpy(row, &Rewind_grid[(size_t) y * (size_t) maze->cols + (size_t) View_x],
+             (size_t) f->cols * sizeof(Cell));
+      continue;
+    }
+    memcpy(row, &maze->grid[y][View_x], (size_t) f->cols * sizeof(Cell));
+    for (int j = 0; j < f->cols; j++) {
+      if (maze->bot_at[y][View_x + j]) {
+        row[j] = get_player_current_char(first_player_at(View_x + j, y));
+      }
+    }
   }
+  f->info_len = snprintf(f->info, sizeof(f->info),
+                         "[Maze Game] %d %s, %d t, %d/%d [%d] m, %d/%d r",
+                         Tick_rate ? Tick_rate : Game_speed,
+                         Tick_rate ? "tps" : "s", Num_teleporters,
+                         Rewind_at >= 0 ? Rewind_liv : Liv_monsters, Num_monsters,
+                         Max_monster_strength, Game_rounds, Game_roundsB);
+  f->info_len = MIN(f->info_len, (int) sizeof(f->info) - 1);
+}
 
-  for (int i = 0; i < visible_rows; i++) {
-    for (int j = 0; j < visible_cols; j++) {
-      char ichar;
-      int player = is_player_position(j, i, current_positions);
-      if (player > 0 ) {
-        ichar = get_player_current_char(player);
+// Draw the maze part of a frame. Only the runs of cells that changed since
+// the last one drawn are drawn, and with a budget no more than that many,
+// starting from the row the last frame stopped at. Returns the number of
+// cells drawn. Holds Curses_lock
+int draw_maze(const BoardFrame *f, int budget) {
+  static int first_row = 0;
+  int rows = f->rows, cols = f->cols;
+  int drawn = 0;
+  if (rows != Shadow_rows || cols != Shadow_cols) {
+    Shadow.assign((size_t) rows * (size_t) cols, (Cell) CELL_STALE);
+    Shadow_rows = rows;
+    Shadow_cols = cols;
+    if (Use_ansi) {
+      // a frame changing every cell, the info line and stats panel
+      Ansi_out.resize((size_t) rows * (size_t) cols * ANSI_CELL_BYTES +
+                      4 * (sizeof(Ansi_lines) + sizeof(Ansi_info)));
+    }
+  }
+  take_stale_rows();
+
+  first_row = budget && first_row < rows ? first_row : 0;
+  for (int n = 0; n < rows; n++) {
+    int i = (first_row + n) % rows;
+    const Cell *frame = &f->cells[(size_t) i * (size_t) cols];
+    Cell *shadow = &Shadow[(size_t) i * (size_t) cols];
+    // the info text covers the top row after the first cell
+    int skip_from = i == 0 ? MIN(1, cols) : cols;
+    int skip_to = i == 0 ? MIN(1 + f->info_len, cols) : cols;
+    if (i == 0) {
+      // cells a shorter text no longer covers
+      int uncovered = MIN(1 + Info_len, cols);
+      if (uncovered > skip_to) {
+        std::fill(shadow + skip_to, shadow + uncovered, (Cell) CELL_STALE);
+      }
+    }
+    for (int j = find_change(frame, shadow, 0, cols);
+         j < cols && (!budget || drawn < budget);
+         j = find_change(frame, shadow, j, cols)) {
+      if (j >= skip_from && j < skip_to) {
+        j = skip_to;
+        continue;
+      }
+      int run = j;
+      while (j < cols && frame[j] != shadow[j] &&
+             !(j >= skip_from && j < skip_to) && (!budget || drawn < budget)) {
+        shadow[j] = frame[j];
+        j++;
+        drawn++;
+      }
+      if (Use_ansi) {
+        // the top row's unchanged cells may be under the info text
+        ansi_move(i ? frame : NULL, i, run);
+        ansi_cells(frame, run, j);
+      } else if (Use_glyph_table) {
+        // the whole run in one call, no decoding or attribute changes
+        Glyph_run.resize((size_t) (j - run));
+        for (int k = run; k < j; k++) {
+          Glyph_run[(size_t) (k - run)] = Glyphs[frame[k] < CELL_CODES ? frame[k] : 0];
+        }
+        mvadd_wchnstr(i, run, Glyph_run.data(), j - run);
       } else {
-        ichar = maze->grid[i][j];
+        move(i, run);
+        for (int k = run; k < j; k++) {
+          draw_cell(frame[k]);
+        }
       }
-      print_char(i, j, ichar);
+    }
+    if (i == 0) {
+      // the cells under the text are drawn once it no longer covers them
+      std::fill(shadow + skip_from, shadow + skip_to, (Cell) CELL_STALE);
+    }
+    if (budget && drawn >= budget) {
+      first_row = i;
+      break;
     }
   }
+  Info_len = f->info_len;
+
   // print game info
+  if (Use_ansi) {
+    if (strcmp(f->info, Ansi_info) != 0 && cols > 1) {
+      snprintf(Ansi_info, sizeof(Ansi_info), "%s", f->info);
+      ansi_text(0, 1, f->info, COLOR_PAIR(11) | A_BOLD, 0);
+    }
+    return drawn;
+  }
   attron(COLOR_PAIR(11) | A_BOLD);
-  mvwprintw(stdscr, 0, 1,
-           "[Maze Game] %d s, %d t, %d/%d [%d] m, %d/%d r",
-           Game_speed, Num_teleporters, Liv_monsters, Num_monsters,
-           Max_monster_strength, Game_rounds, Game_roundsB);
+  mvwprintw(stdscr, 0, 1, "%s", f->info);
   attroff(COLOR_PAIR(11) | A_BOLD);
+  return drawn;
+}
+
+// Draw a whole frame: the maze and the stats panel, sent to the terminal
+// together. Returns the number of maze cells drawn. Holds Curses_lock
+int draw_frame(const BoardFrame *f) {
+  static long long stats_ns = 0;
+  long long now_ns = monotonic_ns();
+  int cells = draw_maze(f, Frame_cells.load(std::memory_order_relaxed));
+  // a terminal that can't keep up gets the stats panel once a second
+  if (!Frame_cap || now_ns - stats_ns >= 1000000000LL) {
+    draw_stats(f);
+    stats_ns = now_ns;
+  } else if (!Use_ansi) {
+    wnoutrefresh(stdscr);
+  }
+  if (Use_ansi) {
+    ansi_flush();
+  } else {
+    doupdate();
+  }
+  return cells;
+}
+
+// Add to the --ansi frame being written
+__attribute__((no_instrument_function)) static inline
+void ansi_put(const char *text, size_t len) {
+  if (Ansi_len + len > Ansi_out.size()) {
+    Ansi_out.resize(2 * (Ansi_len + len)); // only before the first frame
+  }
+  memcpy(&Ansi_out[Ansi_len], text, len);
+  Ansi_len += len;
+}
+
+// How --ansi draws text in a colour pair and attributes
+static AnsiStyle ansi_pair_style(short pair, attr_t attrs) {
+  AnsiStyle s = {-1, -1, (short) ((attrs & A_BOLD) != 0)};
+  if (has_colors()) {
+    pair_content(pair, &s.fg, &s.bg);
+  }
+  return s;
+}
+
+// The SGR parameters of a colour, followed by ';'. base is 30 for the
+// foreground and 40 for the background
+static int ansi_color(char *sgr, size_t size, int c, int base) {
+  // xterm's colours, for terminals that show any colour
+  static const int rgb[8][3] = {
+      {0, 0, 0},     {205, 0, 0},   {0, 205, 0},   {205, 205, 0},
+      {0, 0, 238},   {205, 0, 205}, {0, 205, 205}, {229, 229, 229}};
+  if (c < 0) {
+    return snprintf(sgr, size, "%d;", base + 9);
+  } else if (c < 8 && Ansi_truecolor) {
+    return snprintf(sgr, size, "%d;2;%d;%d;%d;", base + 8, rgb[c][0],
+                    rgb[c][1], rgb[c][2]);
+  } else if (c < 8) {
+    return snprintf(sgr, size, "%d;", base + c);
+  } else if (c < 16) {
+    return snprintf(sgr, size, "%d;", base + 60 + c - 8);
+  }
+  return snprintf(sgr, size, "%d;5;%d;", base + 8, c);
+}
+
+// Switch to a style, sending only what changes
+static void ansi_set_style(AnsiStyle s) {
+  AnsiStyle *now = &Ansi_style;
+  if (now->fg == s.fg && now->bg == s.bg && now->bold == s.bold) {
+    return;
+  }
+  char sgr[64];
+  int len = snprintf(sgr, sizeof(sgr), "\033[");
+  if (now->fg == -2 || (now->bold && !s.bold)) {
+    // bold only goes with everything else
+    len += snprintf(sgr + len, sizeof(sgr) - (size_t) len, "0;");
+    now->fg = now->bg = -1;
+    now->bold = 0;
+  }
+  if (s.bold && !now->bold) {
+    len += snprintf(sgr + len, sizeof(sgr) - (size_t) len, "1;");
+  }
+  if (s.fg != now->fg) {
+    len += ansi_color(sgr + len, sizeof(sgr) - (size_t) len, s.fg, 30);
+  }
+  if (s.bg != now->bg) {
+    len += ansi_color(sgr + len, sizeof(sgr) - (size_t) len, s.bg, 40);
+  }
+  sgr[len - 1] = 'm'; // over the last ';'
+  ansi_put(sgr, (size_t) len);
+  *now = s;
+}
+
+// Write cells [from, to) of a maze row at the cursor, a run of the same
+// cell as one glyph repeated when that's shorter. Only ASCII glyphs are
+// repeated, as ncurses does: some terminals (tmux) repeat nothing else
+static void ansi_cells(const Cell *row, int from, int to) {
+  for (int k = from; k < to;) {
+    const AnsiGlyph *g = &Ansi_glyphs[row[k] < CELL_CODES ? row[k] : 0];
+    int n = 1;
+    while (k + n < to && row[k + n] == row[k]) {
+      n++;
+    }
+    ansi_set_style(g->style);
+    ansi_put(g->text, (size_t) g->len);
+    char rep[16];
+    int len = snprintf(rep, sizeof(rep), "\033[%db", n - 1);
+    if (Ansi_rep && g->len == 1 && len < n - 1) {
+      ansi_put(rep, (size_t) len);
+    } else {
+      for (int r = 1; r < n; r++) {
+        ansi_put(g->text, (size_t) g->len);
+      }
+    }
+    k += n;
+  }
+  Ansi_col = to;
+}
+
+// Move the cursor to row i, column j the shortest way: to there, by so
+// many rows and columns, or over the few unchanged cells of maze row row
+// (NULL if they can't be written again) by writing them again
+static void ansi_move(const Cell *row, int i, int j) {
+  if (!Ansi_len) {
+    // a new frame: ncurses' cursor and attributes are put back after it
+    ansi_put("\0337", 2);
+    Ansi_row = Ansi_col = -1;
+    Ansi_style.fg = -2;
+  }
+  if (Ansi_row == i && Ansi_col == j) {
+    return;
+  }
+  char move[32], step[32];
+  int len, step_len = 0;
+  if (j) {
+    len = snprintf(move, sizeof(move), "\033[%d;%dH", i + 1, j + 1);
+  } else {
+    len = snprintf(move, sizeof(move), "\033[%dH", i + 1);
+  }
+  if (Ansi_row >= 0 && i >= Ansi_row) {
+    int down = i - Ansi_row, right = j - Ansi_col;
+    size_t size = sizeof(step);
+    if (down == 1) {
+      step_len += snprintf(step, size, "\033[B");
+    } else if (down > 1) {
+      step_len += snprintf(step, size, "\033[%dB", down);
+    }
+    size -= (size_t) step_len;
+    if (j == 0 && Ansi_col > 0) {
+      step_len += snprintf(step + step_len, size, "\r");
+    } else if (right == 1) {
+      step_len += snprintf(step + step_len, size, "\033[C");
+    } else if (right > 1) {
+      step_len += snprintf(step + step_len, size, "\033[%dC", right);
+    } else if (right < 0) {
+      step_len += snprintf(step + step_len, size, "\033[%dD", -right);
+    }
+    if (step_len < len) {
+      memcpy(move, step, (size_t) step_len);
+      len = step_len;
+    }
+  }
+  if (row && Ansi_row == i && j > Ansi_col && j - Ansi_col <= ANSI_GAP_MAX) {
+    // take back the cells written if the move is shorter
+    size_t mark = Ansi_len;
+    AnsiStyle style = Ansi_style;
+    int col = Ansi_col;
+    ansi_cells(row, Ansi_col, j);
+    if (Ansi_len - mark <= (size_t) len) {
+      return;
+    }
+    Ansi_len = mark;
+    Ansi_style = style;
+    Ansi_col = col;
+  }
+  ansi_put(move, (size_t) len);
+  Ansi_row = i;
+  Ansi_col = j;
+}
+
+// Write text at row i, column j, up to the last column but one, and clear
+// the rest of the row after it if asked
+static void ansi_text(int i, int j, const char *text, attr_t attrs, int clear) {
+  int len = MIN((int) strlen(text), COLS - 1 - j);
+  if (len <= 0) {
+    return;
+  }
+  ansi_move(NULL, i, j);
+  ansi_set_style(ansi_pair_style((short) PAIR_NUMBER(attrs), attrs));
+  ansi_put(text, (size_t) len);
+  Ansi_col = j + len;
+  if (clear) {
+    AnsiStyle blank = {-1, -1, 0};
+    ansi_set_style(blank);
+    ansi_put("\033[K", 3);
+  }
+}
+
+// The stats panel rows that changed since the last frame, for --ansi
+void ansi_draw_stats(const BoardFrame *f) {
+  if (f->stats_row != Ansi_stats_row) {
+    for (int row = 0; row < STATS_ROWS + 2; row++) {
+      Ansi_lines[row][0] = '\001'; // never a stats row
+    }
+    Ansi_stats_row = f->stats_row;
+  }
+  for (int row = 0; row <= f->num_lines; row++) {
+    const char *text = row ? f->lines[row - 1] : f->header;
+    attr_t attrs = row ? f->line_attrs[row - 1] : A_NORMAL;
+    if (strcmp(text, Ansi_lines[row]) == 0 && attrs == Ansi_line_attrs[row]) {
+      continue;
+    }
+    snprintf(Ansi_lines[row], sizeof(Ansi_lines[row]), "%s", text);
+    Ansi_line_attrs[row] = attrs;
+    ansi_text(f->stats_row + row, 0, text, attrs, 1);
+  }
+}
+
+// Send the --ansi frame in one write(), after whatever ncurses has to send
+// first (a clear, a window closing, the status line). Holds Curses_lock
+void ansi_flush() {
+  wnoutrefresh(stdscr);
+  doupdate();
+  if (!Ansi_len) {
+    return;
+  }
+  ansi_put("\0338", 2);
+  const char *out = Ansi_out.data();
+  size_t left = Ansi_len;
+  while (left > 0) {
+    ssize_t n = write(Ansi_fd, out, left);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n <= 0) {
+      break; // the terminal has gone
+    }
+    out += n;
+    left -= (size_t) n;
+  }
+  Ansi_len = 0;
+}
+
+// print_maze to display all players, teleporters, and monsters, now
+void print_maze() {
+  if (Headless || Fast_forward)
+    return;
+  static BoardFrame now;
+  CursesLock lock;
+  compose_maze(&now);
+  draw_maze(&now, 0);
+  if (Use_ansi) {
+    ansi_flush();
+  }
+}
+
+// Hand the board as it stands to the render thread, replacing the frame it
+// hasn't drawn yet if any. Never waits for the drawing
+void publish_frame() {
+  if (Headless || Fast_forward)
+    return;
+  if (!Render_thread.joinable()) {
+    Render_thread = std::thread(render_worker);
+  }
+  compose_maze(&Frame_back);
+  compose_stats(&Frame_back);
+  Frame_back.generation = Frame_generation; // only this thread changes it
+  {
+    std::lock_guard<std::mutex> lock(Frame_lock);
+    std::swap(Frame_back, Frame_pending);
+    Frame_waiting = 1;
+  }
+  Frame_wake.notify_one();
+}
+
+// Render_thread: draw the latest frame, unless the game thread has drawn
+// something newer itself since it was published
+void render_worker() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(Frame_lock);
+      Frame_wake.wait(lock, [] { return Frame_waiting || Render_quit; });
+      if (Render_quit) {
+        return;
+      }
+      std::swap(Frame_pending, Frame_drawn);
+      Frame_waiting = 0;
+    }
+    // the game thread may hold it for a while (a pause, a battle window)
+    while (!Curses_lock.try_lock_for(std::chrono::milliseconds(POLL_INTERVAL_MS))) {
+      if (Render_quit) {
+        return;
+      }
+    }
+    if (Frame_drawn.generation != Frame_generation) {
+      Curses_lock.unlock();
+      continue;
+    }
+    long long start_ns = monotonic_ns();
+    int cells = draw_frame(&Frame_drawn);
+    Curses_lock.unlock();
+    tcdrain(STDOUT_FILENO); // until sent on a tty, a pty returns at once
+    adapt_pacing(monotonic_ns() - start_ns, cells);
+  }
+}
+
+// Render_thread: keep a slow terminal from falling more than about
+// OUTPUT_TARGET_MS behind, so keys like pause and quit show at once.
+// Frames that take long to go out (write() blocks once the terminal's
+// queue is full) halve the frame rate the game loop publishes at, and
+// each frame draws only the cells the terminal was seen to take in a
+// quarter of the target: the trails change more cells a second than a
+// lower frame rate alone saves. Idle windows double both again
+void adapt_pacing(long long output_ns, int cells) {
+  static long long window_ns = 0, busy_ns = 0, worst_ns = 0, drawn = 0;
+  static int frames = 0, calm = 0;
+  long long now_ns = monotonic_ns();
+  if (!window_ns) {
+    window_ns = now_ns;
+  }
+  busy_ns += output_ns;
+  worst_ns = MAX(worst_ns, output_ns);
+  drawn += cells;
+  frames++;
+  long long span = now_ns - window_ns;
+  if (span < ADAPT_WINDOW_MS * 1000000LL) {
+    return;
+  }
+
+  long long target_ns = OUTPUT_TARGET_MS * 1000000LL;
+  int cap = Frame_cap, budget = Frame_cells;
+  int fps = (int) ((long long) frames * 1000000000LL / span);
+  if (busy_ns * 2 > span || worst_ns > target_ns) {
+    // falling behind
+    calm = 0;
+    cap = MAX(MIN_ADAPT_FPS, (cap ? MIN(cap, fps) : fps) / 2);
+    long long fit = drawn * target_ns / 4 / MAX(busy_ns, 1);
+    fit = MAX(fit, MIN_FRAME_CELLS);
+    budget = (int) (budget ? MIN(fit, budget) : MIN(fit, INT_MAX));
+  } else if (busy_ns * 10 < span && worst_ns < target_ns / 2 &&
+             ++calm >= ADAPT_CALM_WINDOWS) {
+    calm = 0;
+    if (cap) {
+      cap *= 2;
+      budget = (int) MIN(2LL * budget, INT_MAX);
+      if (cap > MAX_FRAME_RATE) {
+        cap = budget = 0;
+      }
+    }
+  }
+  Frame_cap = cap;
+  Frame_cells = budget;
+  window_ns = now_ns;
+  busy_ns = worst_ns = drawn = 0;
+  frames = 0;
+}
+
+void stop_render_thread() {
+  if (!Render_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(Frame_lock);
+    Render_quit = 1;
+  }
+  Frame_wake.notify_all();
+  Render_thread.join();
 }
 
 // Stack operations
@@ -2329,6 +6915,9 @@ void clear_stack(Node **stack) {
  * @param direction The direction of the animation (0 = collapse, 1 = expand)
  */
 void animate_bullseye(int y, int x, int max_radius, int delay_ms, int direction) {
+  if (Headless || Fast_forward)
+    return;
+  CursesLock lock;
   // UTF-8 characters for different rings of the bullseye
   const wchar_t *ring_chars[] = {
       L"●", // Filled circle
@@ -2409,6 +6998,9 @@ void animate_bullseye(int y, int x, int max_radius, int delay_ms, int direction)
     // Delay between frames
     mysleep(delay_ms);
   }
+  // the next frame draws them again (and with --ansi, ncurses moved over
+  // the maze as if it were blank)
+  invalidate_rows(y - max_radius, y + max_radius);
 
   // Restore original color pair
   attron(COLOR_PAIR(old_pair));
@@ -2508,8 +7100,8 @@ void insert_high_score(HighScore scores[], int *count, HighScore new_score, int
 }
 
 // Update high scores at the end of the game
-void update_high_scores(int rows, int cols) {
-  int num_players = NUM_PLAYERS;
+void update_high_scores() {
+  int num_players = Num_players;
   HighScore best_scores[MAX_HIGH_SCORES] = {
       {"                               ", 0, 0, 0, 0, 0, 0},
       {"                               ", 0, 0, 0, 0, 0, 0},
@@ -2532,15 +7124,15 @@ void update_high_scores(int rows, int cols) {
 
   // Process players who finished the race
   for (int i = 0; i < num_players; i++) {
-    if (players[i].reached_goal && players[i].finished_rank == 1) {
+    if (players.reached_goal[i] && players.finished_rank[i] == 1) {
       // Create a new score entry
       HighScore new_score;
 
       // Use the bot name based on player ID 
       // (subtract 1 for 0-based array index)
-      int name_index = players[i].id - 1;
-      if (name_index >= 0 && name_index < NUM_PLAYERS) {
-        strncpy(new_score.name, BOT_NAMES[name_index + 1],
+      int name_index = players.info[i].id - 1;
+      if (name_index >= 0 && name_index < Num_players) {
+        strncpy(new_score.name, players.info[name_index].name,
                 sizeof(new_score.name) - 1);
         new_score.name[sizeof(new_score.name) - 1] =
             '\0'; // Ensure null termination
@@ -2549,10 +7141,10 @@ void update_high_scores(int rows, int cols) {
         exit_game("invalid name_index %d\n", name_index);
       }
 
-      new_score.player_id = players[i].id;
-      new_score.score = calculate_score(players[i].moves, cols, rows);
-      new_score.battles_won = players[i].battles_won;
-      new_score.strength = players[i].strength;
+      new_score.player_id = players.info[i].id;
+      new_score.score = calculate_score(players.moves[i], players.optimal[i]);
+      new_score.battles_won = players.battles_won[i];
+      new_score.strength = players.strength[i];
       new_score.date = current_time;
 
       // Try to insert into best scores
@@ -2573,6 +7165,7 @@ void update_high_scores(int rows, int cols) {
 
 // Display high scores in a ncurses window
 void display_high_scores_window(int count, HighScore best_scores[], HighScore worst_scores[]) {
+  CursesLock lock;
   if (count == 0 || ShowWindows == 0) {
     // No high scores yet
     pauseForUser();
@@ -2618,9 +7211,9 @@ void display_high_scores_window(int count, HighScore best_scores[], HighScore wo
     // Highlight the new high score
     if (best_scores[i].this_run) {
             placed = i;
-            wattron(high_score_win, COLOR_PAIR(players[best_scores[i].player_id - 1].color_pair) | A_BOLD);
+            wattron(high_score_win, COLOR_PAIR(bot_color_pair(best_scores[i].player_id - 1)) | A_BOLD);
         } else {
-            wattron(high_score_win, COLOR_PAIR(players[best_scores[i].player_id - 1].color_pair));
+            wattron(high_score_win, COLOR_PAIR(bot_color_pair(best_scores[i].player_id - 1)));
     }
                                   // # Name   Score Ba St Date
     mvwprintw(high_score_win, 5 + i, 3, "%1d %-6s %4d %2d %2d %s", i + 1,
@@ -2628,9 +7221,9 @@ void display_high_scores_window(int count, HighScore best_scores[], HighScore wo
               best_scores[i].battles_won, best_scores[i].strength, date_str);
 
     if (best_scores[i].this_run) {
-            wattroff(high_score_win, COLOR_PAIR(players[best_scores[i].player_id - 1].color_pair) | A_BOLD);
+            wattroff(high_score_win, COLOR_PAIR(bot_color_pair(best_scores[i].player_id - 1)) | A_BOLD);
         } else {
-            wattroff(high_score_win, COLOR_PAIR(players[best_scores[i].player_id - 1].color_pair));
+            wattroff(high_score_win, COLOR_PAIR(bot_color_pair(best_scores[i].player_id - 1)));
     }
   }
 
@@ -2649,9 +7242,9 @@ void display_high_scores_window(int count, HighScore best_scores[], HighScore wo
     // Highlight the new high score
     if (worst_scores[i].this_run) {
             placed = i * -1;
-            wattron(high_score_win, COLOR_PAIR(players[worst_scores[i].player_id - 1].color_pair) | A_BOLD);
+            wattron(high_score_win, COLOR_PAIR(bot_color_pair(worst_scores[i].player_id - 1)) | A_BOLD);
         } else {
-            wattron(high_score_win, COLOR_PAIR(players[worst_scores[i].player_id - 1].color_pair));
+            wattron(high_score_win, COLOR_PAIR(bot_color_pair(worst_scores[i].player_id - 1)));
     }
 
     mvwprintw(high_score_win, 13 + i, 3, "%1d %-6s %4d %2d %2d %s", i + 1,
@@ -2659,9 +7252,9 @@ void display_high_scores_window(int count, HighScore best_scores[], HighScore wo
               worst_scores[i].battles_won, worst_scores[i].strength, date_str);
 
     if (worst_scores[i].this_run) {
-            wattroff(high_score_win, COLOR_PAIR(players[worst_scores[i].player_id - 1].color_pair) | A_BOLD);
+            wattroff(high_score_win, COLOR_PAIR(bot_color_pair(worst_scores[i].player_id - 1)) | A_BOLD);
         } else {
-            wattroff(high_score_win, COLOR_PAIR(players[worst_scores[i].player_id - 1].color_pair));
+            wattroff(high_score_win, COLOR_PAIR(bot_color_pair(worst_scores[i].player_id - 1)));
     }
   }
 
@@ -2669,23 +7262,23 @@ void display_high_scores_window(int count, HighScore best_scores[], HighScore wo
   if (best_scores[0].this_run) {
     wattron(high_score_win, A_BOLD);
         mvwprintw(high_score_win, (height - 2), (int) ((width - 34) / 2),
-            "** NEW CHAMPION! %s **", BOT_NAMES_LONG[best_scores[0].player_id]);
+            "** NEW CHAMPION! %s **", bot_long_name(best_scores[0].player_id));
     wattroff(high_score_win, A_BOLD);
     } else if(placed > 0) {
         mvwprintw(high_score_win, (height - 2), (int) ((width - 34) / 2),
-            "** Fast PLACED %d %s **", placed+1, BOT_NAMES_LONG[best_scores[placed].player_id]);
+            "** Fast PLACED %d %s **", placed+1, bot_long_name(best_scores[placed].player_id));
   }
 
   // If we have a new worst score, add some congratulatory text
   if (worst_scores[0].this_run) {
     wattron(high_score_win, A_BOLD);
         mvwprintw(high_score_win, (height - 2), (int) ((width - 34) / 2),
-            "** NEW WORST :( %s **", BOT_NAMES_LONG[worst_scores[0].player_id]);
+            "** NEW WORST :( %s **", bot_long_name(worst_scores[0].player_id));
     wattroff(high_score_win, A_BOLD);
     } else if(placed < 0) {
         placed = abs(placed);
         mvwprintw(high_score_win, (height - 2), (int) ((width - 34) / 2),
-            "** Slow PLACED %d %s **", placed+1, BOT_NAMES_LONG[worst_scores[placed].player_id]);
+            "** Slow PLACED %d %s **", placed+1, bot_long_name(worst_scores[placed].player_id));
   }
 
   // Refresh and show the window
@@ -2697,49 +7290,32 @@ void display_high_scores_window(int count, HighScore best_scores[], HighScore wo
   // Clean up
   delwin(high_score_win);
   curs_set(old_curs); // Restore cursor state
+  invalidate_shadow(); // the next frame draws the maze under it again
 
   // Refresh the screen to remove the window
   wnoutrefresh(stdscr);
 }
 
-#define OPTIMAL_PATH_FACTOR 1.5f
 #define SCORE_MULTIPLIER 100.0f
-#define COMPLEXITY_ADJUSTMENT_FACTOR 10.0f
 
-int calculate_score(int moves, int width, int height) {
-  if (moves <= 0 || width <= 0 || height <= 0) {
+// Score a finish by its efficiency, the moves made over the fewest moves
+// possible (the bot's distance field): a perfect run scores 100 and lower
+// is better
+int calculate_score(int moves, int optimal) {
+  if (moves <= 0 || optimal <= 0) {
     return -1; // Error code for invalid input
   }
 
-  // Calculate the effective maze dimensions (in cells, not walls)
-  int effective_width = (int)((float)(width - 1) / 2.0f);
-  int effective_height = (int)((float)(height - 1) / 2.0f);
-
-  // Estimate optimal solution length
-  float estimated_optimal_path =
-      OPTIMAL_PATH_FACTOR * (float)(effective_width + effective_height);
-
-  // Maze complexity factor
-  float maze_complexity = (float)(effective_width * effective_height);
-
-  // Calculate score (lower is better)
-  // Base score is the actual moves normalized by estimated optimal path
-  float efficiency_factor = (float)moves / estimated_optimal_path;
-
-  // Apply a small adjustment based on maze complexity
-  // This makes larger mazes slightly easier to score well on
-  float complexity_adjustment =
-      logf(maze_complexity) / COMPLEXITY_ADJUSTMENT_FACTOR;
-
-  // Final score - lower is better
-  int score = (int)roundf(SCORE_MULTIPLIER *
-                          (efficiency_factor - complexity_adjustment));
+  int score = (int)roundf(SCORE_MULTIPLIER * (float)moves / (float)optimal);
 
   // Ensure score is always positive
   return score > 0 ? score : 1;
 }
 
 void pauseForUser() {
+  if (Headless || Fast_forward)
+    return;
+  CursesLock lock;
   read_keyboard();
   if (WaitForKey) {
     pauseGame();  // calls doupdate()
@@ -2747,12 +7323,33 @@ void pauseForUser() {
     update_status_line(DELAY_MSG);
     mysleep(pauseTime); // calls doupdate()
   }
-  move(maze->rows + 5, 0);
+  move(View_rows + 5, 0);
   wclrtoeol(stdscr);
   read_keyboard();
   doupdate();
 }
 
+// Wait out the game time span to the next event: Game_delay per tick or,
+// with --tps, until the wall clock catches up with the ticks played. Waits
+// under a millisecond add up until they are worth a sleep
+void pace_ticks(int span) {
+  long long wait_ms = (long long) Game_delay * span / TICK_TIME;
+  if (Tick_rate) {
+    long long now_ns = monotonic_ns();
+    Tick_due_ns += (long long) span * 1000000000LL / TICK_TIME / Tick_rate;
+    if (Tick_due_ns < now_ns - TICK_SLACK_NS) {
+      Tick_due_ns = now_ns; // paused, or the ticks are too slow to keep up
+    }
+    wait_ms = (Tick_due_ns - now_ns) / 1000000;
+  }
+  // like mysleep(), but the render thread does the drawing
+  if (wait_ms > 0 && !in_mysleep) {
+    in_mysleep = 1;
+    delay_with_polling((long) wait_ms);
+    in_mysleep = 0;
+  }
+}
+
 void calc_game_speed() {
   double min_speed = 1.0;    // slowest
   double max_speed = 100.0;  // fastest
@@ -2771,14 +7368,29 @@ void calc_game_speed() {
 }
 
 void exit_game(const char *format, ...) {
-  doupdate();
-  tcflush(STDIN_FILENO, TCIFLUSH);
-  endwin();
+  if (Record_file) {
+    record_end();
+    fclose(Record_file);
+    Record_file = NULL;
+  }
+  if (Hash_file) {
+    fclose(Hash_file);
+    Hash_file = NULL;
+  }
+  free_layout(finish_layout());
+  stop_pool();
+  stop_win_thread();
+  stop_render_thread();
+  if (!Headless) {
+    doupdate();
+    tcflush(STDIN_FILENO, TCIFLUSH);
+    endwin();
+  }
   va_list args;
   va_start(args, format);
   vprintf(format, args);  // Forward the varargs to printf
   va_end(args);
-  exit(0);
+  exit(Exit_status);
 }
 
 void update_status_line(const char *format, ...) {
@@ -2786,6 +7398,9 @@ void update_status_line(const char *format, ...) {
   char buffer[STATUS_LINE_MAX];
   char upchar[5] = " ";
 
+  if (Headless)
+    return;
+
   if (isdigit(format[0])) {
     // a key
     direction = atoi(format);
@@ -2812,6 +7427,9 @@ void update_status_line(const char *format, ...) {
     }
     // Reset viewing index to current message
     current_status_index = 0;
+    // keep the history, but nothing is drawn when fast forwarding
+    if (Fast_forward)
+      return;
   }
   // Case 2: Navigate to previous (older) message
   else if (direction == KEY_UP) {
@@ -2832,15 +7450,19 @@ void update_status_line(const char *format, ...) {
   } else {
     exit_game("Illegal value for direction %d\n", direction);
   }
+  // the history is kept even when a stalled terminal can't show it
+  CursesLock lock(1);
+  if (!lock.held)
+    return;
   
   attron(COLOR_PAIR(11) | A_BOLD);
   if (current_status_index == 0) { 
     // Current message - display normally
     if (direction == 0) {
       LastSLupdate = Game_moves;
-      mvwprintw(stdscr, maze->rows + 5, 0, "%s", buffer);
+      mvwprintw(stdscr, View_rows + 5, 0, "%s", buffer);
     } else {
-      mvwprintw(stdscr, maze->rows + 5, 0, "%s", PAUSE_MSG);
+      mvwprintw(stdscr, View_rows + 5, 0, "%s", PAUSE_MSG);
     }
   } else {
     // Past message - show indicator
@@ -2850,7 +7472,7 @@ void update_status_line(const char *format, ...) {
     ) {
       strcpy(upchar , "↑");
     }        
-    mvwprintw(stdscr, maze->rows + 5, 0, "%s↓[%d] %s", upchar, status_lines[current_status_index].move, status_lines[current_status_index].msg);
+    mvwprintw(stdscr, View_rows + 5, 0, "%s↓[%d] %s", upchar, status_lines[current_status_index].move, status_lines[current_status_index].msg);
   }
   wclrtoeol(stdscr);
   attroff(COLOR_PAIR(11) | A_BOLD);
@@ -2861,12 +7483,16 @@ __attribute__((no_instrument_function))
 int read_keyboard() {
   int ch;
   int was_paused = 0;
+
+  if (Headless)
+    return 0;
   
   if(in_read_keyboard) return 0;
+  // keys wait in the terminal while the render thread draws
+  std::unique_lock<std::recursive_timed_mutex> lock(Curses_lock, std::try_to_lock);
+  if (!lock.owns_lock()) return 0;
   in_read_keyboard =1;
-  nodelay(stdscr, TRUE);
-  ch = getch();
-  nodelay(stdscr, FALSE);
+  ch = wgetch(Input_win);
   switch(ch) {
   // PAUSE with SPACE
   case 32:
@@ -2891,6 +7517,9 @@ int read_keyboard() {
     update_status_line("Slowing down...");
     Game_speed--;
     calc_game_speed();
+    if (Tick_rate) {
+      Tick_rate = MAX(Tick_rate * 4 / 5, 1);
+    }
     break;
   // SPEED UP with PLUS
   case 61:
@@ -2898,6 +7527,22 @@ int read_keyboard() {
     update_status_line("Speeding up...");
     Game_speed++;
     calc_game_speed();
+    if (Tick_rate) {
+      Tick_rate = MIN(Tick_rate * 5 / 4 + 1, MAX_TICK_RATE);
+    }
+    break;
+  // SNAPSHOT the game with S (saved at the end of the tick)
+  case 83:
+  case 115:
+    update_status_line("Saving a snapshot...");
+    Snapshot_wanted = 1;
+    break;
+  // FAST FORWARD to the end of the round with F
+  case 70:
+  case 102:
+    update_status_line("Fast forwarding...");
+    doupdate();
+    Fast_forward = 1;
     break;
   // EXIT with ESCAPE
   case 113:
@@ -2914,7 +7559,35 @@ int read_keyboard() {
    case 72:  // 'H'
        show_extended_help_window();
        break;
+ // PAN the view with the arrow keys, FOLLOW the next bot with B and
+ // CENTRE the view on it again with C
+  case KEY_UP:
+  case KEY_SR:
+    pan_view(-1, 0);
+    break;
+  case KEY_DOWN:
+  case KEY_SF:
+    pan_view(1, 0);
+    break;
+  case KEY_LEFT:
+  case KEY_SLEFT:
+    pan_view(0, -1);
+    break;
+  case KEY_RIGHT:
+  case KEY_SRIGHT:
+    pan_view(0, 1);
+    break;
+  case 66:
+  case 98:
+    follow_bot(View_follow + 1 < Num_players ? View_follow + 1 : -1);
+    break;
+  case 67:
+  case 99:
+    follow_bot(View_follow);
+    break;
   case KEY_RESIZE:
+    getmaxyx(stdscr, Term_rows, Term_cols);
+    invalidate_shadow();
     break;        
   case ERR:
     break;  
@@ -2947,11 +7620,15 @@ void pauseGame() {
   int ch;
   
   if(in_pausegame) return;
+  CursesLock lock;
   in_pausegame = 1;
  
   current_status_index = 0; // Reset to current message when pausing
   update_status_line(PAUSE_MSG);
   tcflush(STDIN_FILENO, TCIFLUSH);
+  if (Frame_cells) {
+    print_maze(); // the cells a slow terminal's frames left out
+  }
   paused = 1;
   
   // Enter pause mode loop
@@ -2970,15 +7647,45 @@ void pauseGame() {
       sprintf(key, "%d", KEY_DOWN);
       update_status_line(key);
     }
+    // Rewind the board a tick (left/right) or 100 ticks (PgUp/PgDn)
+    else if (ch == KEY_LEFT || ch == KEY_RIGHT) {
+      rewind_step(ch == KEY_LEFT ? -1 : 1);
+    }
+    else if (ch == KEY_PPAGE || ch == KEY_NPAGE) {
+      rewind_step(ch == KEY_PPAGE ? -100 : 100);
+    }
+    // Pan the view (shifted arrows), follow the next bot or centre on it
+    else if (ch == KEY_SR || ch == KEY_SF) {
+      pan_view(ch == KEY_SR ? -1 : 1, 0);
+    }
+    else if (ch == KEY_SLEFT || ch == KEY_SRIGHT) {
+      pan_view(0, ch == KEY_SLEFT ? -1 : 1);
+    }
+    else if (ch == 'b' || ch == 'B') {
+      follow_bot(View_follow + 1 < Num_players ? View_follow + 1 : -1);
+    }
+    else if (ch == 'c' || ch == 'C') {
+      follow_bot(View_follow);
+    }
     // Exit game early
     else if(ch == 113 || ch == 81 || ch == 27) {
       exit_game("User ended game early\n");
     }
+    // Snapshots are saved between ticks, so play on to the next one
+    else if (ch == ERR && Snapshot_wanted) {
+      paused = 0;
+    }
     // Leave pause mode on any other key press (that's printable)
     else if (ch >= 32 && ch <= 126) {
       paused = 0;
     }
   }
+  // Back to the live board
+  if (Rewind_at >= 0) {
+    Rewind_at = -1;
+    print_maze();
+    display_player_stats();
+  }
   // Reset to current message when unpausing
   current_status_index = 0;
   update_status_line("Continuing...");
@@ -3015,6 +7722,13 @@ void logMessage(const char *format, ...) {
 #endif
 }
 
+// Monotonic clock in nanoseconds, for timing
+long long monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 __attribute__((no_instrument_function))
 void sleep_millis(long ms) {
     struct timespec req, rem;
@@ -3062,9 +7776,12 @@ void delay_with_polling(long total_delay_ms) {
 
 __attribute__((no_instrument_function))
 void mysleep(long total_delay_ms) {
-  if(in_mysleep) return;
+  if(in_mysleep || Headless || Fast_forward) return;
   in_mysleep = 1;  
-  doupdate();
+  {
+    std::lock_guard<std::recursive_timed_mutex> lock(Curses_lock);
+    doupdate();
+  }
   if (total_delay_ms <= POLL_INTERVAL_MS) {
       sleep_millis(total_delay_ms);
   } else {
@@ -3076,48 +7793,56 @@ void mysleep(long total_delay_ms) {
 // function to mark the solution path for a player
 void highlight_player_solution_path(int p) {
   // Now mark each position in the path with solution char
-  char solution_char = get_player_solution_char(p+1);
-  char current_char  = get_player_current_char(p+1);
-  Position end = players[p].current;
+  Cell solution_char = get_player_solution_char(p+1);
+  Cell current_char  = get_player_current_char(p+1);
+  Position end = players.current[p];
   int x = end.x, y = end.y;
+  // a path can't be longer than the maze, this guards against trail loops
+  int steps = maze->rows * maze->cols;
 
-  while (!(x == players[p].start.x && y == players[p].start.y)) {
+  while (!(x == players.info[p].start.x && y == players.info[p].start.y) &&
+         steps-- > 0) {
     // Only overwrite certain cells (don't overwrite special cells)
-    if (maze->grid[y][x] != END1 &&
-        maze->grid[y][x] != END2 &&
-        maze->grid[y][x] != END3 &&
-        maze->grid[y][x] != END4 &&
+    if (!is_end_cell(maze->grid[y][x]) &&
         maze->grid[y][x] != TELEPORTER &&
         maze->grid[y][x] != MONSTER &&
         maze->grid[y][x] != DEFEATED_MONSTER
     ) {
-      maze->grid[y][x] = solution_char;
+      set_cell(x, y, solution_char);
     }    
-    int px = parent_map[p][y][x].x;
-    int py = parent_map[p][y][x].y;
-    x = px;
-    y = py;
+    if (!trail_parent(p, &x, &y)) {
+      break;
+    }
   }
-  print_maze();
-  display_player_stats();
+  // the path is drawn with the next frame
+  if (Headless || Fast_forward || Frame_cap || !in_view(end.y, end.x))
+    return;
+  CursesLock lock(1);
+  if (!lock.held)
+    return;
   // Visualize end point
+  int end_y = end.y - View_y, end_x = end.x - View_x;
   for (int i = 0; i < 5; i++) { // Flicker for 3 cycles
-      print_char(end.y, end.x, current_char);      
+      print_char(end_y, end_x, current_char);      
       wnoutrefresh(stdscr);
       mysleep((int) (pauseTime/40));           // Short delay (50ms)
   
       attron(A_REVERSE);
-      print_char(end.y, end.x, current_char);      
+      print_char(end_y, end_x, current_char);      
       attroff(A_REVERSE);
       wnoutrefresh(stdscr);
       mysleep((int) (pauseTime/40));            // Another delay
   }        
+  // the next frame draws it again (and with --ansi, ncurses moved over the
+  // maze as if it were blank)
+  invalidate_rows(end_y, end_y);
 }
 
 void show_help_window() {
+    CursesLock lock;
     //if (ShowWindows === 0) return;
     
-    int height = 20;
+    int height = 23;
     int width = 60;
     int max_y, max_x;
     getmaxyx(stdscr, max_y, max_x);
@@ -3137,20 +7862,29 @@ void show_help_window() {
     mvwprintw(help_win, 8, 4, "[q/Q/ESC] - Quit Game");
     mvwprintw(help_win, 9, 4, "[k]       - Toggle WaitForKey");
     mvwprintw(help_win,10, 4, "[w]       - Toggle ShowWindows");
-    mvwprintw(help_win,12, 2, "During Pause:");
-    mvwprintw(help_win,13, 4, "[Up/Down] - Scroll Status Messages");
+    mvwprintw(help_win,11, 4, "[f]       - Fast Forward to End of Round");
+    mvwprintw(help_win,12, 4, "[s]       - Save a Snapshot");
+    mvwprintw(help_win,13, 4, "[Arrows]  - Pan the View");
+    mvwprintw(help_win,14, 4, "[b/c]     - Follow the Next Bot / Centre on It");
+    mvwprintw(help_win,15, 2, "During Pause:");
+    mvwprintw(help_win,16, 4, "[Up/Down] - Scroll Status Messages");
+    mvwprintw(help_win,17, 4, "[Left/Right] - Rewind the Board a Tick");
+    mvwprintw(help_win,18, 4, "[PgUp/PgDn]  - Rewind 100 Ticks");
+    mvwprintw(help_win,19, 4, "[Shift+Arrows] - Pan the View");
     
-    mvwprintw(help_win,15, 2, "Press any key to close...");
+    mvwprintw(help_win,21, 2, "Press any key to close...");
     
     wnoutrefresh(help_win);
     doupdate();
     
     getch(); // Wait for any key
     delwin(help_win);
+    invalidate_shadow(); // the next frame draws the maze under it again
     wnoutrefresh(stdscr);
 }
 
 void show_extended_help_window() {
+    CursesLock lock;
     //if (ShowWindows === 0) return;
     
     int height = 24;
@@ -3188,6 +7922,7 @@ void show_extended_help_window() {
     
     getch(); // Wait for any key
     delwin(help_win);
+    invalidate_shadow(); // the next frame draws the maze under it again
     wnoutrefresh(stdscr);
 }
 